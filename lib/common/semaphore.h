@@ -0,0 +1,146 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2021 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+
+#ifndef _SEMAPHORE_H_INCLUDED
+#define _SEMAPHORE_H_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+using std::atomic;
+using std::condition_variable;
+using std::lock_guard;
+using std::memory_order_acquire;
+using std::memory_order_relaxed;
+using std::mutex;
+using std::unique_lock;
+
+/*
+* Counting semaphore for the single producer / single consumer slot hand-off.
+* The count is an atomic, notify() and a successful wait() do not take any lock.
+* wait() spins briefly before it parks the thread (futex on Linux, condition variable elsewhere),
+* a negative count tells notify() that the other side is parked and has to be woken up.
+* The spin is bounded by time, about what parking and waking the thread costs, as a pause takes from about
+* 10 to 140 cycles depending on the CPU. There is no spinning on single core machines.
+* semaphore_bench in lib/libdsdpcm/bench measures the hand-off for other spin times.
+*/
+class semaphore {
+	static constexpr int SPIN_TIME_NS = 2000;
+	atomic<int> m_cnt{0};
+	atomic<int> m_wake{0};
+#if !defined(__linux__)
+	mutex m_mtx;
+	condition_variable m_cv;
+#endif
+public:
+	semaphore() = default;
+	semaphore(const semaphore& sem) = delete;
+	semaphore(semaphore&& sem) = delete;
+	semaphore operator=(const semaphore& sem) = delete;
+	void notify() {
+		if (m_cnt.fetch_add(1) < 0) {
+			wake();
+		}
+	}
+	void wait() {
+		auto spin_time = spin_time_ns().load(memory_order_relaxed);
+		if (spin_time > 0) {
+			auto spin_end = std::chrono::steady_clock::now() + std::chrono::nanoseconds(spin_time);
+			do {
+				if (try_wait()) {
+					return;
+				}
+				cpu_relax();
+			} while (std::chrono::steady_clock::now() < spin_end);
+		}
+		if (m_cnt.fetch_sub(1) > 0) {
+			return;
+		}
+		park();
+	}
+	bool try_wait() {
+		auto cnt = m_cnt.load(memory_order_relaxed);
+		while (cnt > 0) {
+			if (m_cnt.compare_exchange_weak(cnt, cnt - 1, memory_order_acquire, memory_order_relaxed)) {
+				return true;
+			}
+		}
+		return false;
+	}
+	static atomic<int>& spin_time_ns() {
+		static atomic<int> spin_time{(std::thread::hardware_concurrency() > 1) ? SPIN_TIME_NS : 0};
+		return spin_time;
+	}
+private:
+	static void cpu_relax() {
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+		_mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+		__asm__ __volatile__("yield");
+#endif
+	}
+#if defined(__linux__)
+	void park() {
+		for (;;) {
+			auto wake = m_wake.load(memory_order_relaxed);
+			while (wake > 0) {
+				if (m_wake.compare_exchange_weak(wake, wake - 1, memory_order_acquire, memory_order_relaxed)) {
+					return;
+				}
+			}
+			syscall(SYS_futex, reinterpret_cast<int*>(&m_wake), FUTEX_WAIT_PRIVATE, 0, nullptr, nullptr, 0);
+		}
+	}
+	void wake() {
+		// The parked side may return and destroy the semaphore as soon as m_wake is raised, the futex call only uses the address
+		auto address = reinterpret_cast<int*>(&m_wake);
+		m_wake.fetch_add(1);
+		syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+	}
+#else
+	void park() {
+		unique_lock<mutex> lock(m_mtx);
+		while (m_wake.load() == 0) {
+			m_cv.wait(lock);
+		}
+		m_wake--;
+	}
+	void wake() {
+		lock_guard<mutex> lock(m_mtx);
+		m_wake++;
+		m_cv.notify_one();
+	}
+#endif
+};
+
+#endif
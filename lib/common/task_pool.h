@@ -0,0 +1,142 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2021 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+
+#ifndef _TASK_POOL_H_INCLUDED
+#define _TASK_POOL_H_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+* Process-wide pool of worker threads shared by the DST decoder and the DSD to PCM converter.
+* Every worker owns a task queue: it takes its own tasks from the back and steals from the front of the
+* other queues when its own one is empty. Tasks submitted from outside the pool are spread round-robin.
+* The pool is created on first use with one worker per hardware thread and lives until the process exits.
+*/
+class task_pool_t {
+	using task_t = std::function<void()>;
+	struct task_queue_t {
+		std::mutex         mtx;
+		std::deque<task_t> tasks;
+	};
+	std::vector<std::unique_ptr<task_queue_t>> task_queues;
+	std::vector<std::thread>                   task_threads;
+	std::atomic<unsigned int>                  next_queue{0};
+	std::atomic<int>                           pending_tasks{0};
+	std::mutex                                 idle_mtx;
+	std::condition_variable                    idle_cv;
+	bool                                       run_pool;
+public:
+	static task_pool_t& get_instance() {
+		static task_pool_t task_pool;
+		return task_pool;
+	}
+	unsigned int get_threads() {
+		return (unsigned int)task_threads.size();
+	}
+	void submit(task_t task) {
+		auto queue_nr = get_worker_nr();
+		if (queue_nr < 0) {
+			queue_nr = (int)(next_queue++ % task_queues.size());
+		}
+		{
+			std::lock_guard<std::mutex> lock(task_queues[queue_nr]->mtx);
+			task_queues[queue_nr]->tasks.push_back(std::move(task));
+		}
+		{
+			std::lock_guard<std::mutex> lock(idle_mtx);
+			pending_tasks++;
+		}
+		idle_cv.notify_one();
+	}
+	task_pool_t(const task_pool_t&) = delete;
+	task_pool_t& operator=(const task_pool_t&) = delete;
+private:
+	task_pool_t() {
+		auto threads = std::max(std::thread::hardware_concurrency(), 1u);
+		run_pool = true;
+		for (auto i = 0u; i < threads; i++) {
+			task_queues.emplace_back(new task_queue_t());
+		}
+		for (auto i = 0u; i < threads; i++) {
+			task_threads.emplace_back(&task_pool_t::run_worker, this, (int)i);
+		}
+	}
+	~task_pool_t() {
+		{
+			std::lock_guard<std::mutex> lock(idle_mtx);
+			run_pool = false;
+		}
+		idle_cv.notify_all();
+		for (auto& task_thread : task_threads) {
+			task_thread.join();
+		}
+	}
+	static int& get_worker_nr() {
+		static thread_local int worker_nr = -1;
+		return worker_nr;
+	}
+	bool take_task(int queue_nr, bool steal, task_t& task) {
+		auto& task_queue = *task_queues[queue_nr];
+		std::lock_guard<std::mutex> lock(task_queue.mtx);
+		if (task_queue.tasks.empty()) {
+			return false;
+		}
+		if (steal) {
+			task = std::move(task_queue.tasks.front());
+			task_queue.tasks.pop_front();
+		}
+		else {
+			task = std::move(task_queue.tasks.back());
+			task_queue.tasks.pop_back();
+		}
+		pending_tasks--;
+		return true;
+	}
+	void run_worker(int worker_nr) {
+		get_worker_nr() = worker_nr;
+		auto queues = (int)task_queues.size();
+		for (;;) {
+			task_t task;
+			auto found = take_task(worker_nr, false, task);
+			for (auto i = 1; !found && i < queues; i++) {
+				found = take_task((worker_nr + i) % queues, true, task);
+			}
+			if (found) {
+				task();
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(idle_mtx);
+			idle_cv.wait(lock, [this] { return !run_pool || pending_tasks > 0; });
+			if (!run_pool) {
+				break;
+			}
+		}
+	}
+};
+
+#endif
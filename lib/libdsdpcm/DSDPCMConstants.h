@@ -19,9 +19,11 @@
 
 #pragma once
 
+#include <float.h>
 #include <stdint.h>
 
 constexpr uint8_t DSD_SILENCE_BYTE = 0x69;
+constexpr int     DSD_TILE_SAMPLES = 4096;
 
 const auto CTABLES = [](auto fir_length) {
 	return (fir_length + 7) / 8;
@@ -35,7 +37,11 @@ constexpr int PCMFIR3_2_LENGTH  = 151;
 constexpr int PCMFIR_OFFSET     = 0x7fffffff;
 constexpr int PCMFIR_SCALE      = 31;
 
-const double DSDFIR1_8_COEFS[DSDFIR1_8_LENGTH] = {
+constexpr int PCMRESAMPLER_INTERPOLATION = 160;
+constexpr int PCMRESAMPLER_DECIMATION    = 147;
+constexpr int PCMRESAMPLER_PHASE_LENGTH  = 128;
+
+constexpr double DSDFIR1_8_COEFS[DSDFIR1_8_LENGTH] = {
 	-142,
 	-651,
 	-1997,
@@ -118,7 +124,7 @@ const double DSDFIR1_8_COEFS[DSDFIR1_8_LENGTH] = {
 	-142,
 };
 
-const double DSDFIR1_16_COEFS[DSDFIR1_16_LENGTH] = {
+constexpr double DSDFIR1_16_COEFS[DSDFIR1_16_LENGTH] = {
 	-42,
 	-102,
 	-220,
@@ -281,7 +287,7 @@ const double DSDFIR1_16_COEFS[DSDFIR1_16_LENGTH] = {
 	-42,
 };
 
-const double DSDFIR1_64_COEFS[DSDFIR1_64_LENGTH] = {
+constexpr double DSDFIR1_64_COEFS[DSDFIR1_64_LENGTH] = {
 	1652, 421, 509, 606, 714, 832,
 	960, 1098, 1245, 1402, 1567, 1739,
 	1917, 2101, 2287, 2475, 2663, 2848,
@@ -574,3 +580,99 @@ const double PCMFIR3_2_COEFS[PCMFIR3_2_LENGTH] = {
 	0,
 	-5412,
 };
+
+/*
+* Sample arithmetic of the filter stages. Floating point samples are used as they are.
+* Fixed point samples are Q4.28 integers and PCM coefficients Q1.31, their products are accumulated in 64 bits
+* and rounded back to Q4.28 with saturation.
+* The DSD stage adds its lookup table entries in 32 bits, max_ctable_sum() is the largest sum of the table
+* magnitudes that cannot overflow, each of the ctables entries being rounded by up to half a step.
+*/
+template<typename real_t>
+struct DSDPCMSample {
+	using acc_t = real_t;
+	using out_t = real_t;
+	static constexpr double max_ctable_sum(int) {
+		return DBL_MAX;
+	}
+	static constexpr real_t from_sample(double value) {
+		return (real_t)value;
+	}
+	static constexpr real_t from_coef(double value) {
+		return (real_t)value;
+	}
+	static real_t from_acc(acc_t acc) {
+		return acc;
+	}
+	static out_t to_out(real_t sample) {
+		return sample;
+	}
+};
+
+template<>
+struct DSDPCMSample<int32_t> {
+	using acc_t = int64_t;
+	using out_t = float;
+	static constexpr int SAMPLE_BITS = 28;
+	static constexpr int COEF_BITS = 31;
+	static constexpr double max_ctable_sum(int ctables) {
+		return (2147483647.0 - 0.5 * ctables) / (double)(1u << SAMPLE_BITS);
+	}
+	static constexpr int32_t saturate(double value) {
+		return (value >= 2147483647.0) ? INT32_MAX : (value <= -2147483648.0) ? INT32_MIN : (int32_t)((value < 0) ? value - 0.5 : value + 0.5);
+	}
+	static constexpr int32_t from_sample(double value) {
+		return saturate(value * (double)(1u << SAMPLE_BITS));
+	}
+	static constexpr int32_t from_coef(double value) {
+		return saturate(value * (double)(1u << COEF_BITS));
+	}
+	static int32_t from_acc(int64_t acc) {
+		acc = (acc + ((int64_t)1 << (COEF_BITS - 1))) >> COEF_BITS;
+		return (int32_t)((acc > INT32_MAX) ? INT32_MAX : (acc < INT32_MIN) ? INT32_MIN : acc);
+	}
+	static float to_out(int32_t sample) {
+		return (float)sample * (1.0f / (float)(1u << SAMPLE_BITS));
+	}
+};
+
+/*
+* Lookup tables of the built-in DSD filters at unity gain, generated at compile time.
+* Table ct holds the sum of the 8 taps ct * 8 .. ct * 8 + 7 for each DSD byte, a set bit adds the tap, a cleared one subtracts it.
+* Neighbouring entries differ in a single bit, so each entry is derived from a previous one with one addition.
+* The taps are integers and the scale is a power of two, which keeps the result identical to a runtime build.
+*/
+template<typename real_t, int fir_length>
+struct DSDPCMCTables {
+	real_t ctables[(fir_length + 7) / 8][256];
+};
+
+template<typename real_t, int fir_length>
+constexpr DSDPCMCTables<real_t, fir_length> make_ctables(const double (&fir_coefs)[fir_length], const double fir_gain) {
+	DSDPCMCTables<real_t, fir_length> out{};
+	for (int ct = 0; ct < (fir_length + 7) / 8; ct++) {
+		double coefs[8] = {};
+		double cvalues[256] = {};
+		for (int j = 0; j < 8 && ct * 8 + j < fir_length; j++) {
+			coefs[j] = fir_coefs[fir_length - 1 - (ct * 8 + j)];
+			cvalues[0] -= coefs[j];
+		}
+		out.ctables[ct][0] = DSDPCMSample<real_t>::from_sample(cvalues[0] * fir_gain);
+		for (int i = 1; i < 256; i++) {
+			int j = 7;
+			while (!((i >> (7 - j)) & 1)) {
+				j--;
+			}
+			cvalues[i] = cvalues[i & (i - 1)] + 2 * coefs[j];
+			out.ctables[ct][i] = DSDPCMSample<real_t>::from_sample(cvalues[i] * fir_gain);
+		}
+	}
+	return out;
+}
+
+template<typename real_t>
+inline constexpr auto DSDFIR1_8_CTABLES = make_ctables<real_t>(DSDFIR1_8_COEFS, 1.0 / (double)(1u << 28));
+template<typename real_t>
+inline constexpr auto DSDFIR1_16_CTABLES = make_ctables<real_t>(DSDFIR1_16_COEFS, 1.0 / (double)(1u << 28));
+template<typename real_t>
+inline constexpr auto DSDFIR1_64_CTABLES = make_ctables<real_t>(DSDFIR1_64_COEFS, 1.0 / (double)(1u << 31));
@@ -28,6 +28,7 @@
 #include "DSDPCMFir_IPP.h"
 #include "PCMPCMFir_IPP.h"
 #endif
+#include "PCMPCMFirHalfband.h"
 
 enum class conv_type_e {
 	UNKNOWN    = -1,
@@ -36,6 +37,19 @@ enum class conv_type_e {
 	USER       =  2
 };
 
+enum class conv_precision_e {
+	FP32  = 0,
+	FP64  = 1,
+	INT32 = 2
+};
+
+enum class pcm_format_e {
+	FLOAT = 0,
+	S32   = 1,
+	S24   = 2,
+	S16   = 3
+};
+
 template<typename real_t>
 class DSDPCMConverter {
 protected:
@@ -58,7 +72,8 @@ public:
 		return delay;
 	}
 	virtual void init(DSDPCMFilterSetup<real_t>& flt_setup, int dsd_samples) = 0;
-	virtual int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) = 0;
+	virtual int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples, int dsd_stride) = 0;
+	virtual void reset() = 0;
 protected:
 	void alloc_pcm_temp1(int pcm_samples) {
 		free_pcm_temp1();
@@ -0,0 +1,71 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2021 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+
+#pragma once
+
+#include "DSDPCMConverter.h"
+#include "DSDPCMFirChannels.h"
+
+#include <memory>
+#include <vector>
+
+/*
+* Converts all channels of a stream in a single call. The first stage runs channel vectorised in DSDPCMFirChannels,
+* the remaining stages run per channel in cascades of type conv_t whose first stage is a DSDPCMFirLane.
+* The input is the interleaved DSD stream, channel ch is written to pcm_data + ch * pcm_stride.
+*/
+template<typename real_t, typename conv_t>
+class DSDPCMConverterChannels : public DSDPCMConverter<real_t> {
+	using DSDPCMConverter<real_t>::delay;
+	DSDPCMFirChannels<real_t> dsd_fir1;
+	std::vector<std::unique_ptr<conv_t>> converters;
+	int pcm_stride;
+public:
+	DSDPCMConverterChannels(int p_channels, int p_pcm_stride) {
+		converters.resize(p_channels);
+		for (auto& converter : converters) {
+			converter = std::make_unique<conv_t>();
+		}
+		pcm_stride = p_pcm_stride;
+	}
+	void init(DSDPCMFilterSetup<real_t>& flt_setup, int dsd_samples) {
+		for (auto& converter : converters) {
+			converter->init(flt_setup, dsd_samples);
+		}
+		auto& fir1 = converters[0]->get_fir1();
+		dsd_fir1.init(fir1.get_ctables(), fir1.get_length(), fir1.get_decimation() * 8, (int)converters.size(), dsd_samples);
+		delay = converters[0]->get_delay();
+	}
+	int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples, int dsd_stride) {
+		dsd_fir1.run(dsd_data, dsd_samples, dsd_stride);
+		auto pcm_samples = 0;
+		for (auto ch = 0; ch < (int)converters.size(); ch++) {
+			converters[ch]->get_fir1().set_data(dsd_fir1.get_data(ch));
+			pcm_samples = converters[ch]->convert(dsd_data + ch, pcm_data + ch * pcm_stride, dsd_samples, dsd_stride);
+		}
+		return pcm_samples;
+	}
+	void reset() {
+		dsd_fir1.reset();
+		for (auto& converter : converters) {
+			converter->reset();
+		}
+	}
+};
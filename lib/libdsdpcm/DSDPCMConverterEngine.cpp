@@ -19,8 +19,10 @@
 
 #include "DSDPCMConverterMultistage.h"
 #include "DSDPCMConverterDirect.h"
+#include "DSDPCMConverterChannels.h"
 #include "DSDPCMConverterEngine.h"
 #include <algorithm>
+#include <chrono>
 #include <math.h>
 #include <stdio.h>
 
@@ -41,18 +43,33 @@
 using std::min;
 using std::max;
 
+constexpr int LOAD_AVERAGE_FRAMES = 8;
+
+template<typename sample_t, int bits>
+static inline sample_t quantize_sample(double value, double dither) {
+	constexpr auto scale = (double)((int64_t)1 << (bits - 1));
+	value = value * scale + dither;
+	value = (value < -scale) ? -scale : (value > scale - 1.0) ? scale - 1.0 : value;
+	return (sample_t)((value < 0.0) ? value - 0.5 : value + 0.5);
+}
+
 template<typename real_t>
-static void converter_thread(DSDPCMConverterSlot<real_t>& slot) {
-	while (slot.run_slot) {
-		slot.dsd_semaphore.wait();
-		if (slot.run_slot) {
-			slot.pcm_samples = slot.converter->convert(slot.dsd_data, slot.pcm_data, slot.dsd_samples);
-		}
-		else {
-			slot.pcm_samples = 0;
+static void run_slot(DSDPCMConverterSlot<real_t>& slot) {
+	task_pool_t::get_instance().submit([&slot] {
+		if (slot.reset_slot) {
+			slot.converter->reset();
 		}
+		slot.pcm_samples = slot.converter->convert(slot.dsd_data, slot.pcm_data, slot.dsd_samples, slot.dsd_stride);
 		slot.pcm_semaphore.notify();
+	});
+}
+
+template<typename real_t, template<typename, int, typename> class conv_t, int decimation>
+static DSDPCMConverter<real_t>* new_converter(int group_channels, int pcm_stride) {
+	if (group_channels > 1) {
+		return new DSDPCMConverterChannels<real_t, conv_t<real_t, decimation, DSDPCMFirLane<real_t>>>(group_channels, pcm_stride);
 	}
+	return new conv_t<real_t, decimation, DSDPCMFir<real_t>>();
 }
 
 DSDPCMConverterEngine::DSDPCMConverterEngine() {
@@ -60,11 +77,32 @@ DSDPCMConverterEngine::DSDPCMConverterEngine() {
 	framerate = 0;
 	dsd_samplerate = 0;
 	pcm_samplerate = 0;
+	conv_samplerate = 0;
 	dB_gain = 0.0f;
+	conv_gain = 1.0;
 	conv_delay = 0.0f;
 	conv_type = conv_type_e::UNKNOWN;
+	conv_precision = conv_precision_e::FP32;
+	conv_phase = filter_phase_e::LINEAR;
 	conv_called = false;
 	conv_need_init = true;
+	conv_load = 0.0;
+	conv_load_frames = 0;
+	conv_frame_parallel = false;
+	conv_channel_group = false;
+	conv_flush = false;
+	pcm_format = pcm_format_e::FLOAT;
+	pcm_dither = false;
+	dither_state = 0x9e3779b9;
+	pcm_temp = nullptr;
+	resample_data = nullptr;
+	resample_samples = 0;
+	frame_chunks = 1;
+	preroll_samples = 0;
+	stream_data = nullptr;
+	stream_samples = 0;
+	stream_frame = 0;
+	flush_samples = 0;
 	for (int i = 0; i < 256; i++) {
 		swap_bits[i] = 0;
 		for (int j = 0; j < 8; j++) {
@@ -82,9 +120,64 @@ float DSDPCMConverterEngine::get_delay() {
 	return conv_delay;
 }
 
+float DSDPCMConverterEngine::get_load() {
+	return (float)conv_load;
+}
+
+int DSDPCMConverterEngine::get_load_frames() {
+	return conv_load_frames;
+}
+
 void DSDPCMConverterEngine::set_gain(float p_dB_gain) {
-	conv_need_init = conv_need_init || (dB_gain != p_dB_gain);
+	// Gain is applied to the converter output, so the filters keep their tables and history
 	dB_gain = p_dB_gain;
+	conv_gain = pow(10.0, dB_gain / 20.0);
+}
+
+void DSDPCMConverterEngine::set_frame_parallel(bool p_frame_parallel) {
+	conv_need_init = conv_need_init || (conv_frame_parallel != p_frame_parallel);
+	conv_frame_parallel = p_frame_parallel;
+}
+
+void DSDPCMConverterEngine::set_channel_group(bool p_channel_group) {
+	conv_need_init = conv_need_init || (conv_channel_group != p_channel_group);
+	conv_channel_group = p_channel_group;
+}
+
+void DSDPCMConverterEngine::set_flush(bool p_flush) {
+	// Sequential slots read the caller's frame in place, so the tail convert(nullptr, ...) mirrors is only kept when asked for
+	conv_flush = p_flush;
+}
+
+void DSDPCMConverterEngine::set_filter_phase(filter_phase_e p_filter_phase) {
+	conv_need_init = conv_need_init || (conv_phase != p_filter_phase);
+	conv_phase = p_filter_phase;
+}
+
+void DSDPCMConverterEngine::set_channel_gain(int p_channel, float p_gain) {
+	// Linear gain on top of set_gain(), used to trim single channels such as LFE
+	if (p_channel >= (int)channel_gain.size()) {
+		channel_gain.resize(p_channel + 1, 1.0);
+	}
+	channel_gain[p_channel] = p_gain;
+}
+
+void DSDPCMConverterEngine::set_output_format(pcm_format_e p_pcm_format, bool p_pcm_dither) {
+	// Integer formats are written by the output copy, so the converters are not affected
+	pcm_format = p_pcm_format;
+	pcm_dither = p_pcm_dither && p_pcm_format != pcm_format_e::FLOAT;
+}
+
+int DSDPCMConverterEngine::get_output_bytes(pcm_format_e p_pcm_format) {
+	switch (p_pcm_format) {
+	case pcm_format_e::S16:
+		return sizeof(int16_t);
+	case pcm_format_e::S24:
+	case pcm_format_e::S32:
+		return sizeof(int32_t);
+	default:
+		return sizeof(float);
+	}
 }
 
 bool DSDPCMConverterEngine::is_convert_called() {
@@ -95,8 +188,8 @@ void DSDPCMConverterEngine::need_init() {
 	conv_need_init = true;
 }
 
-int DSDPCMConverterEngine::init(int p_channels, int p_framerate, int p_dsd_samplerate, int p_pcm_samplerate, conv_type_e p_conv_type, bool p_conv_fp64, double* p_fir_coefs, int p_fir_length) {
-	if (!conv_need_init && channels == p_channels && framerate == p_framerate && dsd_samplerate == p_dsd_samplerate && pcm_samplerate == p_pcm_samplerate && conv_type == p_conv_type && conv_fp64 == p_conv_fp64) {
+int DSDPCMConverterEngine::init(int p_channels, int p_framerate, int p_dsd_samplerate, int p_pcm_samplerate, conv_type_e p_conv_type, conv_precision_e p_conv_precision, const double* p_fir_coefs, int p_fir_length) {
+	if (!conv_need_init && channels == p_channels && framerate == p_framerate && dsd_samplerate == p_dsd_samplerate && pcm_samplerate == p_pcm_samplerate && conv_type == p_conv_type && conv_precision == p_conv_precision) {
 		return 1;
 	}
 	if (p_conv_type == conv_type_e::USER) {
@@ -109,168 +202,267 @@ int DSDPCMConverterEngine::init(int p_channels, int p_framerate, int p_dsd_sampl
 	framerate = p_framerate;
 	dsd_samplerate = p_dsd_samplerate;
 	pcm_samplerate = p_pcm_samplerate;
+	conv_samplerate = pcm_samplerate;
+	if (pcm_samplerate % 48000 == 0) {
+		// 48 kHz family rates are converted at the matching 44.1 kHz family rate and resampled by 160 / 147
+		conv_samplerate = pcm_samplerate / PCMRESAMPLER_INTERPOLATION * PCMRESAMPLER_DECIMATION;
+	}
 	conv_type = p_conv_type;
-	conv_fp64 = p_conv_fp64;
-	if (p_conv_fp64) {
-		fltSetup_fp64.set_gain(dB_gain);
+	conv_precision = p_conv_precision;
+	if (conv_precision == conv_precision_e::FP64) {
 		fltSetup_fp64.set_fir1_64_coefs(p_fir_coefs, p_fir_length);
+		fltSetup_fp64.set_phase(conv_phase);
 		init_slots<double>(convSlots_fp64, fltSetup_fp64);
 		conv_delay = convSlots_fp64[0].converter->get_delay();
 	}
+	else if (conv_precision == conv_precision_e::INT32) {
+		fltSetup_i32.set_fir1_64_coefs(p_fir_coefs, p_fir_length);
+		fltSetup_i32.set_phase(conv_phase);
+		init_slots<int32_t>(convSlots_i32, fltSetup_i32);
+		conv_delay = convSlots_i32[0].converter->get_delay();
+	}
 	else {
-		fltSetup_fp32.set_gain(dB_gain);
 		fltSetup_fp32.set_fir1_64_coefs(p_fir_coefs, p_fir_length);
+		fltSetup_fp32.set_phase(conv_phase);
 		init_slots<float>(convSlots_fp32, fltSetup_fp32);
 		conv_delay = convSlots_fp32[0].converter->get_delay();
 	}
+	if (conv_samplerate != pcm_samplerate) {
+		auto resampler_delay = resamplers_fp64.empty() ? resamplers_fp32[0].get_delay() : resamplers_fp64[0].get_delay();
+		conv_delay = conv_delay * PCMRESAMPLER_INTERPOLATION / PCMRESAMPLER_DECIMATION + resampler_delay;
+	}
+	// The flush mirrors as much of the last frame as it takes to output twice the delay, so its cost follows the phase.
+	// The filters keep their own history, and frame chunks take theirs from the stream before the mirrored tail.
+	auto flush_pcm = (int)ceil(2.0f * conv_delay * conv_samplerate / pcm_samplerate);
+	flush_samples = min(dsd_samplerate / 8 / framerate, max(flush_pcm, 1) * (dsd_samplerate / conv_samplerate / 8));
 	conv_called = false;
 	conv_need_init = false;
+	conv_load = 0.0;
+	conv_load_frames = 0;
 	return 0;
 }
 
 int DSDPCMConverterEngine::free() {
-	if (conv_fp64) {
+	if (conv_precision == conv_precision_e::FP64) {
 		free_slots<double>(convSlots_fp64);
 	}
+	else if (conv_precision == conv_precision_e::INT32) {
+		free_slots<int32_t>(convSlots_i32);
+	}
 	else {
 		free_slots<float>(convSlots_fp32);
 	}
 	return 0;
 }
 
-int DSDPCMConverterEngine::convert(uint8_t* p_dsd_data, int p_dsd_samples, float* p_pcm_data) {
+int DSDPCMConverterEngine::convert(uint8_t* p_dsd_data, int p_dsd_samples, void* p_pcm_data) {
 	int pcm_samples = 0;
 	if (!p_dsd_data) {
-		if (conv_fp64) {
-			pcm_samples = convertR<double>(convSlots_fp64, p_pcm_data);
+		if (conv_precision == conv_precision_e::FP64) {
+			pcm_samples = convertR<double>(convSlots_fp64, p_pcm_data, pcm_format);
+		}
+		else if (conv_precision == conv_precision_e::INT32) {
+			pcm_samples = convertR<int32_t>(convSlots_i32, p_pcm_data, pcm_format);
 		}
 		else {
-			pcm_samples = convertR<float>(convSlots_fp32, p_pcm_data);
+			pcm_samples = convertR<float>(convSlots_fp32, p_pcm_data, pcm_format);
 		}
 		return pcm_samples;
 	}
+	auto convert_start = std::chrono::steady_clock::now();
+	auto pcm_data = p_pcm_data;
+	auto format = pcm_format;
 	if (!conv_called) {
-		if (conv_fp64) {
+		if (conv_precision == conv_precision_e::FP64) {
 			convertL<double>(convSlots_fp64, p_dsd_data, p_dsd_samples);
 		}
+		else if (conv_precision == conv_precision_e::INT32) {
+			convertL<int32_t>(convSlots_i32, p_dsd_data, p_dsd_samples);
+		}
 		else {
 			convertL<float>(convSlots_fp32, p_dsd_data, p_dsd_samples);
 		}
+		// The lead-in is extrapolated on float samples, integer output is quantized afterwards
+		if (format != pcm_format_e::FLOAT) {
+			pcm_data = pcm_temp;
+			format = pcm_format_e::FLOAT;
+		}
+	}
+	if (conv_precision == conv_precision_e::FP64) {
+		pcm_samples = convert<double>(convSlots_fp64, p_dsd_data, p_dsd_samples, pcm_data, format);
 	}
-	if (conv_fp64) {
-		pcm_samples = convert<double>(convSlots_fp64, p_dsd_data, p_dsd_samples, p_pcm_data);
+	else if (conv_precision == conv_precision_e::INT32) {
+		pcm_samples = convert<int32_t>(convSlots_i32, p_dsd_data, p_dsd_samples, pcm_data, format);
 	}
 	else {
-		pcm_samples = convert<float>(convSlots_fp32, p_dsd_data, p_dsd_samples, p_pcm_data);
+		pcm_samples = convert<float>(convSlots_fp32, p_dsd_data, p_dsd_samples, pcm_data, format);
 	}
 	if (!conv_called) {
-		extrapolateL<float>(p_pcm_data, pcm_samples);
+		extrapolateL<float>((float*)pcm_data, pcm_samples);
+		if (pcm_data != p_pcm_data) {
+			quantize(p_pcm_data, pcm_temp, pcm_samples);
+		}
 		conv_called = true;
 	}
+	else {
+		// The lead-in frame converts twice and is left out, the others are measured against the time they play for
+		auto convert_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - convert_start).count();
+		auto frame_time = (double)p_dsd_samples / channels * 8 / dsd_samplerate;
+		auto load = convert_time / frame_time;
+		conv_load = (conv_load_frames == 0) ? load : conv_load + (load - conv_load) / LOAD_AVERAGE_FRAMES;
+		conv_load_frames++;
+	}
 	return pcm_samples;
 }
 
+void DSDPCMConverterEngine::preroll(uint8_t* p_dsd_data, int p_dsd_samples) {
+	// Runs an already played frame through the filters and resamplers and drops the output, so an engine set up
+	// mid-track goes on from its history at the next convert() instead of a lead-in
+	if (conv_precision == conv_precision_e::FP64) {
+		convert<double>(convSlots_fp64, p_dsd_data, p_dsd_samples, pcm_temp, pcm_format_e::FLOAT);
+	}
+	else if (conv_precision == conv_precision_e::INT32) {
+		convert<int32_t>(convSlots_i32, p_dsd_data, p_dsd_samples, pcm_temp, pcm_format_e::FLOAT);
+	}
+	else {
+		convert<float>(convSlots_fp32, p_dsd_data, p_dsd_samples, pcm_temp, pcm_format_e::FLOAT);
+	}
+	conv_called = true;
+}
+
 template<typename real_t>
-bool DSDPCMConverterEngine::init_slots(vector<DSDPCMConverterSlot<real_t>>& convSlots, DSDPCMFilterSetup<real_t>& fltSetup) {
-	convSlots.resize(channels);
-	int dsd_samples = dsd_samplerate / 8 / framerate;
-	int pcm_samples = pcm_samplerate / framerate;
-	int decimation = dsd_samplerate / pcm_samplerate;
-	for (auto& slot : convSlots) {
-		slot.dsd_data = (uint8_t*)DSDPCMUtil::mem_alloc(dsd_samples * sizeof(uint8_t));
-		slot.dsd_samples = dsd_samples;
-		slot.pcm_data = (real_t*)DSDPCMUtil::mem_alloc(pcm_samples * sizeof(real_t));
-		slot.pcm_samples = 0;
-		switch (conv_type) {
-		case conv_type_e::MULTISTAGE:
-		{
-			DSDPCMConverter<real_t>* pConv = nullptr;
-			switch (decimation) {
-			case 1024:
-				pConv = new DSDPCMConverterMultistage<real_t, 1024>();
-				break;
-			case 512:
-				pConv = new DSDPCMConverterMultistage<real_t, 512>();
-				break;
-			case 256:
-				pConv = new DSDPCMConverterMultistage<real_t, 256>();
-				break;
-			case 128:
-				pConv = new DSDPCMConverterMultistage<real_t, 128>();
-				break;
-			case 64:
-				pConv = new DSDPCMConverterMultistage<real_t, 64>();
-				break;
-			case 32:
-				pConv = new DSDPCMConverterMultistage<real_t, 32>();
-				break;
-			case 16:
-				pConv = new DSDPCMConverterMultistage<real_t, 16>();
-				break;
-			case 8:
-				pConv = new DSDPCMConverterMultistage<real_t, 8>();
-				break;
-			}
-			pConv->init(fltSetup, dsd_samples);
-			slot.converter = pConv;
+DSDPCMConverter<real_t>* DSDPCMConverterEngine::create_converter(DSDPCMFilterSetup<real_t>& fltSetup, int dsd_samples, int group_channels, int pcm_stride) {
+	DSDPCMConverter<real_t>* pConv = nullptr;
+	int decimation = dsd_samplerate / conv_samplerate;
+	switch (conv_type) {
+	case conv_type_e::MULTISTAGE:
+		switch (decimation) {
+		case 1024:
+			pConv = new_converter<real_t, DSDPCMConverterMultistage, 1024>(group_channels, pcm_stride);
 			break;
-		}
-		case conv_type_e::DIRECT:
-		case conv_type_e::USER:
-		{
-			DSDPCMConverter<real_t>* pConv = nullptr;
-			switch (decimation) {
-			case 1024:
-				pConv = new DSDPCMConverterDirect<real_t, 1024>();
-				break;
-			case 512:
-				pConv = new DSDPCMConverterDirect<real_t, 512>();
-				break;
-			case 256:
-				pConv = new DSDPCMConverterDirect<real_t, 256>();
-				break;
-			case 128:
-				pConv = new DSDPCMConverterDirect<real_t, 128>();
-				break;
-			case 64:
-				pConv = new DSDPCMConverterDirect<real_t, 64>();
-				break;
-			case 32:
-				pConv = new DSDPCMConverterDirect<real_t, 32>();
-				break;
-			case 16:
-				pConv = new DSDPCMConverterDirect<real_t, 16>();
-				break;
-			case 8:
-				pConv = new DSDPCMConverterDirect<real_t, 8>();
-				break;
-			}
-			pConv->init(fltSetup, dsd_samples);
-			slot.converter = pConv;
+		case 512:
+			pConv = new_converter<real_t, DSDPCMConverterMultistage, 512>(group_channels, pcm_stride);
+			break;
+		case 256:
+			pConv = new_converter<real_t, DSDPCMConverterMultistage, 256>(group_channels, pcm_stride);
+			break;
+		case 128:
+			pConv = new_converter<real_t, DSDPCMConverterMultistage, 128>(group_channels, pcm_stride);
+			break;
+		case 64:
+			pConv = new_converter<real_t, DSDPCMConverterMultistage, 64>(group_channels, pcm_stride);
+			break;
+		case 32:
+			pConv = new_converter<real_t, DSDPCMConverterMultistage, 32>(group_channels, pcm_stride);
+			break;
+		case 16:
+			pConv = new_converter<real_t, DSDPCMConverterMultistage, 16>(group_channels, pcm_stride);
+			break;
+		case 8:
+			pConv = new_converter<real_t, DSDPCMConverterMultistage, 8>(group_channels, pcm_stride);
 			break;
 		}
-		default:
+		break;
+	case conv_type_e::DIRECT:
+	case conv_type_e::USER:
+		switch (decimation) {
+		case 1024:
+			pConv = new_converter<real_t, DSDPCMConverterDirect, 1024>(group_channels, pcm_stride);
+			break;
+		case 512:
+			pConv = new_converter<real_t, DSDPCMConverterDirect, 512>(group_channels, pcm_stride);
+			break;
+		case 256:
+			pConv = new_converter<real_t, DSDPCMConverterDirect, 256>(group_channels, pcm_stride);
+			break;
+		case 128:
+			pConv = new_converter<real_t, DSDPCMConverterDirect, 128>(group_channels, pcm_stride);
+			break;
+		case 64:
+			pConv = new_converter<real_t, DSDPCMConverterDirect, 64>(group_channels, pcm_stride);
+			break;
+		case 32:
+			pConv = new_converter<real_t, DSDPCMConverterDirect, 32>(group_channels, pcm_stride);
+			break;
+		case 16:
+			pConv = new_converter<real_t, DSDPCMConverterDirect, 16>(group_channels, pcm_stride);
+			break;
+		case 8:
+			pConv = new_converter<real_t, DSDPCMConverterDirect, 8>(group_channels, pcm_stride);
 			break;
 		}
-		slot.run_slot = true;
-		slot.run_thread = thread(converter_thread<real_t>, ref(slot));
-		if (!slot.run_thread.joinable()) {
-			LOG(LOG_ERROR, ("Could not start decoder thread"));
-			return false;
+		break;
+	default:
+		break;
+	}
+	if (pConv) {
+		pConv->init(fltSetup, dsd_samples);
+	}
+	return pConv;
+}
+
+template<typename real_t>
+bool DSDPCMConverterEngine::init_slots(vector<DSDPCMConverterSlot<real_t>>& convSlots, DSDPCMFilterSetup<real_t>& fltSetup) {
+	int dsd_samples = dsd_samplerate / 8 / framerate;
+	int pcm_samples = conv_samplerate / framerate;
+	int decimation = dsd_samplerate / conv_samplerate;
+	frame_chunks = 1;
+	preroll_samples = 0;
+	// A channel group converts every channel of a chunk in one task, frame chunks are not used with it
+	auto group_channels = (conv_channel_group && channels > 1) ? channels : 1;
+	if (conv_frame_parallel && group_channels == 1) {
+		// Each chunk is primed with enough preceding DSD data to fill the history of every filter stage.
+		// The history spans the whole filter length, which is the linear phase delay twice, whatever phase is used.
+		auto span_setup = fltSetup;
+		span_setup.set_phase(filter_phase_e::LINEAR);
+		auto pConv = create_converter<real_t>(span_setup, dsd_samples, 1, 0);
+		auto preroll_pcm = pConv ? (int)ceil(2.0f * pConv->get_delay()) + 2 : pcm_samples;
+		delete pConv;
+		auto threads = (int)task_pool_t::get_instance().get_threads();
+		frame_chunks = max(1, min((threads + channels - 1) / channels, pcm_samples / preroll_pcm));
+		if (frame_chunks > 1) {
+			preroll_samples = preroll_pcm * decimation / 8;
 		}
 	}
+	// Slots read the interleaved frame in place, the first filter stage splits the channels.
+	// The stream holds the lead-in frame, the preroll of frame chunks and the tail of the last frame for the flush.
+	stream_data = (uint8_t*)DSDPCMUtil::mem_alloc((preroll_samples + dsd_samples) * channels * sizeof(uint8_t));
+	stream_samples = 0;
+	stream_frame = 0;
+	pcm_temp = (float*)DSDPCMUtil::mem_alloc(pcm_samplerate / framerate * channels * sizeof(float));
+	int chunk_pcm_samples = (pcm_samples + frame_chunks - 1) / frame_chunks + preroll_samples / (decimation / 8);
+	if (conv_samplerate != pcm_samplerate) {
+		using out_t = typename DSDPCMSample<real_t>::out_t;
+		auto& resamplers = get_resamplers<out_t>();
+		resamplers.resize(channels);
+		for (auto& resampler : resamplers) {
+			resampler.init(PCMRESAMPLER_INTERPOLATION, PCMRESAMPLER_DECIMATION, PCMRESAMPLER_PHASE_LENGTH);
+		}
+		resample_samples = chunk_pcm_samples;
+		resample_data = (uint8_t*)DSDPCMUtil::mem_alloc((resample_samples + resamplers[0].get_out_samples(resample_samples)) * sizeof(out_t));
+	}
+	int chunk_dsd_samples = chunk_pcm_samples * decimation / 8;
+	convSlots.resize(channels / group_channels * frame_chunks);
+	for (auto& slot : convSlots) {
+		slot.dsd_data = nullptr;
+		slot.dsd_samples = 0;
+		slot.dsd_stride = channels;
+		slot.channels = group_channels;
+		slot.pcm_data = (real_t*)DSDPCMUtil::mem_alloc(group_channels * chunk_pcm_samples * sizeof(real_t));
+		slot.pcm_stride = chunk_pcm_samples;
+		slot.pcm_samples = 0;
+		slot.pcm_offset = 0;
+		slot.converter = create_converter<real_t>(fltSetup, chunk_dsd_samples, group_channels, chunk_pcm_samples);
+		slot.reset_slot = frame_chunks > 1;
+	}
 	return true;
 }
 
 template<typename real_t>
 void DSDPCMConverterEngine::free_slots(vector<DSDPCMConverterSlot<real_t>>& convSlots) {
 	for (auto& slot : convSlots) {
-		slot.run_slot = false;
-		slot.dsd_semaphore.notify(); // Release worker (decoding) thread for exit
-		slot.run_thread.join(); // Wait until worker (decoding) thread exit
 		delete slot.converter;
 		slot.converter = nullptr;
-		DSDPCMUtil::mem_free(slot.dsd_data);
 		slot.dsd_data = nullptr;
 		slot.dsd_samples = 0;
 		DSDPCMUtil::mem_free(slot.pcm_data);
@@ -278,72 +470,132 @@ void DSDPCMConverterEngine::free_slots(vector<DSDPCMConverterSlot<real_t>>& conv
 		slot.pcm_samples = 0;
 	}
 	convSlots.resize(0);
+	DSDPCMUtil::mem_free(stream_data);
+	stream_data = nullptr;
+	DSDPCMUtil::mem_free(pcm_temp);
+	pcm_temp = nullptr;
+	resamplers_fp32.clear();
+	resamplers_fp64.clear();
+	DSDPCMUtil::mem_free(resample_data);
+	resample_data = nullptr;
+	resample_samples = 0;
+	frame_chunks = 1;
+	preroll_samples = 0;
 }
 
 template<typename real_t>
-int DSDPCMConverterEngine::convert(vector<DSDPCMConverterSlot<real_t>>& convSlots, uint8_t* dsd_data, int dsd_samples, float* pcm_data) {
-	int pcm_samples = 0;
-	int ch = 0;
-	for (auto& slot : convSlots)	{
-		slot.dsd_samples = dsd_samples / channels;
-		for (int sample = 0; sample < slot.dsd_samples; sample++)	{
-			slot.dsd_data[sample] = dsd_data[sample * channels + ch];
-		}
-		slot.dsd_semaphore.notify(); // Release worker (decoding) thread on the loaded slot
-		ch++;
+int DSDPCMConverterEngine::convert(vector<DSDPCMConverterSlot<real_t>>& convSlots, uint8_t* dsd_data, int dsd_samples, void* pcm_data, pcm_format_e format) {
+	auto frame_samples = dsd_samples / channels;
+	if (frame_chunks > 1) {
+		// Frame chunks are primed from the end of the previous frame, so the frame runs on from it in the stream
+		load_stream(dsd_data, frame_samples, false);
+		return convert_chunks<real_t>(convSlots, stream_data + preroll_samples * channels, stream_frame, pcm_data, format);
 	}
-	ch = 0;
-	for (auto& slot : convSlots)	{
-		slot.pcm_semaphore.wait();	// Wait until worker (decoding) thread is complete
-		for (int sample = 0; sample < slot.pcm_samples; sample++)	{
-			pcm_data[sample * channels + ch] = (float)slot.pcm_data[sample];
-		}
-		pcm_samples += slot.pcm_samples;
-		ch++;
-	}
-	return pcm_samples;
+	stream_frame = conv_flush ? min(flush_samples, frame_samples) : 0;
+	memcpy(stream_data, dsd_data + (frame_samples - stream_frame) * channels, stream_frame * channels);
+	return convert_chunks<real_t>(convSlots, dsd_data, frame_samples, pcm_data, format);
 }
 
 template<typename real_t>
 int DSDPCMConverterEngine::convertL(vector<DSDPCMConverterSlot<real_t>>& convSlots, uint8_t* dsd_data, int dsd_samples) {
-	int ch = 0;
-	for (auto& slot : convSlots)	{
-		slot.dsd_samples = dsd_samples / channels;
-		for (int sample = 0; sample < slot.dsd_samples; sample++)	{
-			slot.dsd_data[sample] = swap_bits[dsd_data[(slot.dsd_samples - 1 - sample) * channels + ch]];
-		}
-		slot.dsd_semaphore.notify(); // Release worker (decoding) thread on the loaded slot
-		ch++;
-	}
-	for (auto& slot : convSlots)	{
-		slot.pcm_semaphore.wait(); // Wait until worker (decoding) thread is complete
+	load_stream(dsd_data, dsd_samples / channels, true);
+	if (frame_chunks > 1) {
+		return 0;
 	}
+	convert_chunks<real_t>(convSlots, stream_data, stream_frame, nullptr, pcm_format_e::FLOAT);
 	return 0;
 }
 
 template<typename real_t>
-int DSDPCMConverterEngine::convertR(vector<DSDPCMConverterSlot<real_t>>& convSlots, float* pcm_data) {
-	int pcm_samples = 0;
-	for (auto& slot : convSlots)	{
-		for (int sample = 0; sample < slot.dsd_samples / 2; sample++)	{
-			uint8_t temp = slot.dsd_data[slot.dsd_samples - 1 - sample];
-			slot.dsd_data[slot.dsd_samples - 1 - sample] = swap_bits[slot.dsd_data[sample]];
-			slot.dsd_data[sample] = swap_bits[temp];
-		}
-		slot.dsd_semaphore.notify(); // Release worker (decoding) thread on the loaded slot
+int DSDPCMConverterEngine::convertR(vector<DSDPCMConverterSlot<real_t>>& convSlots, void* pcm_data, pcm_format_e format) {
+	if (stream_frame <= 0) {
+		return 0;
 	}
+	reverse_stream(min(flush_samples, stream_frame));
+	return convert_chunks<real_t>(convSlots, stream_data + preroll_samples * channels, stream_frame, pcm_data, format);
+}
+
+template<typename real_t>
+int DSDPCMConverterEngine::convert_chunks(vector<DSDPCMConverterSlot<real_t>>& convSlots, uint8_t* frame_data, int frame_samples, void* pcm_data, pcm_format_e format) {
+	using out_t = typename DSDPCMSample<real_t>::out_t;
+	int dsd_per_pcm = dsd_samplerate / conv_samplerate / 8;
+	int frame_pcm_samples = frame_samples / dsd_per_pcm;
 	int ch = 0;
-	for (auto& slot : convSlots)	{
-		slot.pcm_semaphore.wait();	// Wait until worker (decoding) thread is complete
-		for (int sample = 0; sample < slot.pcm_samples; sample++)	{
-			pcm_data[sample * channels + ch] = (float)slot.pcm_data[sample];
+	int chunk = 0;
+	for (auto& slot : convSlots) {
+		auto chunk_begin = frame_pcm_samples * chunk / frame_chunks * dsd_per_pcm;
+		auto chunk_end = (frame_chunks > 1) ? frame_pcm_samples * (chunk + 1) / frame_chunks * dsd_per_pcm : frame_samples;
+		auto preroll = (int)min<int64_t>(preroll_samples, stream_samples + chunk_begin);
+		slot.dsd_data = frame_data + (chunk_begin - preroll) * channels + ch;
+		slot.dsd_samples = preroll + chunk_end - chunk_begin;
+		slot.pcm_offset = preroll / dsd_per_pcm;
+		run_slot(slot); // Convert the loaded slot on the task pool
+		if (++chunk == frame_chunks) {
+			chunk = 0;
+			ch += slot.channels;
+		}
+	}
+	int pcm_samples = 0;
+	auto& resamplers = get_resamplers<out_t>();
+	auto resample_in = (out_t*)resample_data;
+	auto resample_out = resample_in + resample_samples;
+	auto resample_pos = 0;
+	ch = 0;
+	chunk = 0;
+	for (auto& slot : convSlots) {
+		slot.pcm_semaphore.wait(); // Wait until worker (decoding) thread is complete
+		for (auto slot_ch = 0; slot_ch < slot.channels; slot_ch++) {
+			// Channels of a group come from a single chunk, each starts its own resampler output
+			if (slot_ch > 0) {
+				resample_pos = 0;
+			}
+			auto slot_data = slot.pcm_data + slot_ch * slot.pcm_stride + slot.pcm_offset;
+			auto slot_samples = slot.pcm_samples - slot.pcm_offset;
+			auto pcm_gain = (out_t)(conv_gain * get_channel_gain(ch + slot_ch));
+			if (resamplers.empty()) {
+				if (pcm_data) {
+					write_slot<real_t>(pcm_data, frame_pcm_samples * chunk / frame_chunks * channels + ch + slot_ch, slot_data, slot_samples, pcm_gain, format);
+				}
+				pcm_samples += slot_samples;
+			}
+			else if (pcm_data) {
+				// Chunks of a channel reach the resampler in order, its output position runs on from chunk to chunk
+				for (auto sample = 0; sample < slot_samples; sample++) {
+					resample_in[sample] = DSDPCMSample<real_t>::to_out(slot_data[sample]);
+				}
+				auto out_samples = resamplers[ch + slot_ch].run(resample_in, resample_out, slot_samples);
+				write_slot<out_t>(pcm_data, resample_pos * channels + ch + slot_ch, resample_out, out_samples, pcm_gain, format);
+				resample_pos += out_samples;
+				pcm_samples += out_samples;
+			}
+		}
+		if (++chunk == frame_chunks) {
+			chunk = 0;
+			ch += slot.channels;
+			resample_pos = 0;
 		}
-		pcm_samples += slot.pcm_samples;
-		ch++;
 	}
 	return pcm_samples;
 }
 
+template<typename real_t>
+void DSDPCMConverterEngine::write_slot(void* pcm_data, int pcm_index, const real_t* slot_data, int samples, typename DSDPCMSample<real_t>::out_t gain, pcm_format_e format) {
+	switch (format) {
+	case pcm_format_e::S32:
+		write_pcm<int32_t, 32>((int32_t*)pcm_data + pcm_index, slot_data, samples, gain);
+		break;
+	case pcm_format_e::S24:
+		write_pcm<int32_t, 24>((int32_t*)pcm_data + pcm_index, slot_data, samples, gain);
+		break;
+	case pcm_format_e::S16:
+		write_pcm<int16_t, 16>((int16_t*)pcm_data + pcm_index, slot_data, samples, gain);
+		break;
+	default:
+		write_pcm<float, 0>((float*)pcm_data + pcm_index, slot_data, samples, gain);
+		break;
+	}
+}
+
 template<typename real_t>
 void DSDPCMConverterEngine::extrapolateL(float* data, int samples) {
 	auto t0 = (int)(2.0f * get_delay() + 0.5f);
@@ -358,3 +610,98 @@ void DSDPCMConverterEngine::extrapolateL(float* data, int samples) {
 		}
 	}
 }
+
+template<typename sample_t, int bits, typename real_t>
+void DSDPCMConverterEngine::write_pcm(sample_t* pcm_data, const real_t* slot_data, int samples, typename DSDPCMSample<real_t>::out_t gain) {
+	for (auto sample = 0; sample < samples; sample++) {
+		auto value = DSDPCMSample<real_t>::to_out(slot_data[sample]) * gain;
+		if constexpr (bits == 0) {
+			pcm_data[sample * channels] = (float)value;
+		}
+		else {
+			pcm_data[sample * channels] = quantize_sample<sample_t, bits>(value, pcm_dither ? get_dither() : 0.0);
+		}
+	}
+}
+
+void DSDPCMConverterEngine::quantize(void* pcm_data, const float* data, int samples) {
+	for (auto sample = 0; sample < samples; sample++) {
+		auto dither = pcm_dither ? get_dither() : 0.0;
+		switch (pcm_format) {
+		case pcm_format_e::S32:
+			((int32_t*)pcm_data)[sample] = quantize_sample<int32_t, 32>(data[sample], dither);
+			break;
+		case pcm_format_e::S24:
+			((int32_t*)pcm_data)[sample] = quantize_sample<int32_t, 24>(data[sample], dither);
+			break;
+		case pcm_format_e::S16:
+			((int16_t*)pcm_data)[sample] = quantize_sample<int16_t, 16>(data[sample], dither);
+			break;
+		default:
+			((float*)pcm_data)[sample] = data[sample];
+			break;
+		}
+	}
+}
+
+template<typename out_t>
+vector<PCMPCMResampler<out_t>>& DSDPCMConverterEngine::get_resamplers() {
+	if constexpr (std::is_same_v<out_t, double>) {
+		return resamplers_fp64;
+	}
+	else {
+		return resamplers_fp32;
+	}
+}
+
+double DSDPCMConverterEngine::get_channel_gain(int ch) {
+	return (ch < (int)channel_gain.size()) ? channel_gain[ch] : 1.0;
+}
+
+double DSDPCMConverterEngine::get_dither() {
+	// Two uniform 16 bit values from a xorshift generator add up to a triangular (TPDF) dither of +-1 LSB
+	auto x = dither_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	dither_state = x;
+	return (double)((int32_t)(x & 0xffff) + (int32_t)(x >> 16) - 0xffff) * (1.0 / 65536.0);
+}
+
+void DSDPCMConverterEngine::load_stream(uint8_t* dsd_data, int dsd_samples, bool reverse) {
+	auto data = stream_data;
+	memmove(data, data + stream_frame * channels, preroll_samples * channels);
+	data += preroll_samples * channels;
+	if (reverse) {
+		for (auto sample = 0; sample < dsd_samples; sample++) {
+			for (auto ch = 0; ch < channels; ch++) {
+				data[sample * channels + ch] = swap_bits[dsd_data[(dsd_samples - 1 - sample) * channels + ch]];
+			}
+		}
+	}
+	else {
+		memcpy(data, dsd_data, dsd_samples * channels);
+	}
+	stream_samples += stream_frame;
+	stream_frame = dsd_samples;
+}
+
+void DSDPCMConverterEngine::reverse_stream(int dsd_samples) {
+	auto data = stream_data;
+	memmove(data, data + stream_frame * channels, preroll_samples * channels);
+	data += preroll_samples * channels;
+	// The tail of the last frame is reversed in place and moved up to start the stream frame
+	auto tail = data + (stream_frame - dsd_samples) * channels;
+	for (auto sample = 0; sample < (dsd_samples + 1) / 2; sample++) {
+		auto data_l = tail + sample * channels;
+		auto data_r = tail + (dsd_samples - 1 - sample) * channels;
+		for (auto ch = 0; ch < channels; ch++) {
+			auto temp = data_r[ch];
+			data_r[ch] = swap_bits[data_l[ch]];
+			data_l[ch] = swap_bits[temp];
+		}
+	}
+	memmove(data, tail, dsd_samples * channels);
+	stream_samples += stream_frame;
+	stream_frame = dsd_samples;
+}
@@ -19,15 +19,14 @@
 
 #pragma once
 
-#include <thread>
 #include <vector>
 
 #include "semaphore.h"
+#include "task_pool.h"
 #include "DSDPCMConverter.h"
+#include "PCMPCMResampler.h"
 
-using std::thread;
 using std::vector;
-using std::ref;
 
 void log_printf(const char* fmt, ...);
 
@@ -36,27 +35,37 @@ class DSDPCMConverterSlot {
 public:
 	uint8_t*  dsd_data;
 	int       dsd_samples;
+	int       dsd_stride;
+	int       channels;
 	real_t*   pcm_data;
+	int       pcm_stride;
 	int       pcm_samples;
-	semaphore dsd_semaphore;
+	int       pcm_offset;
 	semaphore pcm_semaphore;
-	bool      run_slot;
-	thread    run_thread;
+	bool      reset_slot;
 	DSDPCMConverter<real_t>* converter;
 	DSDPCMConverterSlot() {
-		run_slot = false;
+		reset_slot = false;
 		dsd_data = nullptr;
 		dsd_samples = 0;
+		dsd_stride = 1;
+		channels = 1;
 		pcm_data = nullptr;
+		pcm_stride = 0;
 		pcm_samples = 0;
+		pcm_offset = 0;
 		converter = nullptr;
 	}
 	DSDPCMConverterSlot(const DSDPCMConverterSlot<real_t>& slot) {
-		run_slot = slot.run_slot;
+		reset_slot = slot.reset_slot;
 		dsd_data = slot.dsd_data;
 		dsd_samples = slot.dsd_samples;
+		dsd_stride = slot.dsd_stride;
+		channels = slot.channels;
 		pcm_data = slot.pcm_data;
+		pcm_stride = slot.pcm_stride;
 		pcm_samples = slot.pcm_samples;
+		pcm_offset = slot.pcm_offset;
 		converter = slot.converter;
 	}
 };
@@ -66,32 +75,77 @@ class DSDPCMConverterEngine {
 	int   framerate;
 	int   dsd_samplerate;
 	int   pcm_samplerate;
+	int   conv_samplerate;
 	float dB_gain;
+	double conv_gain;
 	float conv_delay;
 	conv_type_e conv_type;
-	bool        conv_fp64;
+	conv_precision_e conv_precision;
+	filter_phase_e conv_phase;
 	bool        conv_called;
 	bool        conv_need_init;
-	vector<DSDPCMConverterSlot<float>>  convSlots_fp32;
-	DSDPCMFilterSetup<float>            fltSetup_fp32;
-	vector<DSDPCMConverterSlot<double>> convSlots_fp64;
-	DSDPCMFilterSetup<double>           fltSetup_fp64;
+	bool        conv_frame_parallel;
+	bool        conv_channel_group;
+	bool        conv_flush;
+	double      conv_load;
+	int         conv_load_frames;
+	pcm_format_e pcm_format;
+	bool        pcm_dither;
+	uint32_t    dither_state;
+	vector<double> channel_gain;
+	float*      pcm_temp;
+	uint8_t*    resample_data;
+	int         resample_samples;
+	int         frame_chunks;
+	int         preroll_samples;
+	int64_t     stream_samples;
+	int         stream_frame;
+	int         flush_samples;
+	uint8_t*    stream_data;
+	vector<DSDPCMConverterSlot<float>>   convSlots_fp32;
+	DSDPCMFilterSetup<float>             fltSetup_fp32;
+	vector<DSDPCMConverterSlot<double>>  convSlots_fp64;
+	DSDPCMFilterSetup<double>            fltSetup_fp64;
+	vector<DSDPCMConverterSlot<int32_t>> convSlots_i32;
+	DSDPCMFilterSetup<int32_t>           fltSetup_i32;
+	vector<PCMPCMResampler<float>>       resamplers_fp32;
+	vector<PCMPCMResampler<double>>      resamplers_fp64;
 	uint8_t swap_bits[256];
 public:
 	DSDPCMConverterEngine();
 	~DSDPCMConverterEngine();
 	float get_delay();
+	float get_load();
+	int get_load_frames();
 	void set_gain(float p_dB_gain);
+	void set_frame_parallel(bool p_frame_parallel);
+	void set_channel_group(bool p_channel_group);
+	void set_flush(bool p_flush);
+	void set_filter_phase(filter_phase_e p_filter_phase);
+	void set_channel_gain(int p_channel, float p_gain);
+	void set_output_format(pcm_format_e p_pcm_format, bool p_pcm_dither);
+	static int get_output_bytes(pcm_format_e p_pcm_format);
 	bool is_convert_called();
 	void need_init();
-	int init(int p_channels, int p_framerate, int p_dsd_samplerate, int p_pcm_samplerate, conv_type_e p_conv_type, bool p_conv_fp64, double* p_fir_coefs, int p_fir_length);
+	int init(int p_channels, int p_framerate, int p_dsd_samplerate, int p_pcm_samplerate, conv_type_e p_conv_type, conv_precision_e p_conv_precision, const double* p_fir_coefs, int p_fir_length);
 	int free();
-	int convert(uint8_t* p_dsd_data, int p_dsd_samples, float* p_pcm_data);
+	int convert(uint8_t* p_dsd_data, int p_dsd_samples, void* p_pcm_data);
+	void preroll(uint8_t* p_dsd_data, int p_dsd_samples);
 private:
+	template<typename real_t> DSDPCMConverter<real_t>* create_converter(DSDPCMFilterSetup<real_t>& fltSetup, int dsd_samples, int group_channels, int pcm_stride);
 	template<typename real_t> bool init_slots(vector<DSDPCMConverterSlot<real_t>>& convSlots, DSDPCMFilterSetup<real_t>& fltSetup);
 	template<typename real_t> void free_slots(vector<DSDPCMConverterSlot<real_t>>& convSlots);
-	template<typename real_t> int convert(vector<DSDPCMConverterSlot<real_t>>& convSlots, uint8_t* dsd_data, int dsd_samples, float* pcm_data);
+	template<typename real_t> int convert(vector<DSDPCMConverterSlot<real_t>>& convSlots, uint8_t* dsd_data, int dsd_samples, void* pcm_data, pcm_format_e format);
 	template<typename real_t> int convertL(vector<DSDPCMConverterSlot<real_t>>& convSlots, uint8_t* dsd_data, int dsd_samples);
-	template<typename real_t> int convertR(vector<DSDPCMConverterSlot<real_t>>& convSlots, float* pcm_data);
+	template<typename real_t> int convertR(vector<DSDPCMConverterSlot<real_t>>& convSlots, void* pcm_data, pcm_format_e format);
+	template<typename real_t> int convert_chunks(vector<DSDPCMConverterSlot<real_t>>& convSlots, uint8_t* frame_data, int frame_samples, void* pcm_data, pcm_format_e format);
 	template<typename real_t> void extrapolateL(float* data, int samples);
+	template<typename real_t> void write_slot(void* pcm_data, int pcm_index, const real_t* slot_data, int samples, typename DSDPCMSample<real_t>::out_t gain, pcm_format_e format);
+	template<typename sample_t, int bits, typename real_t> void write_pcm(sample_t* pcm_data, const real_t* slot_data, int samples, typename DSDPCMSample<real_t>::out_t gain);
+	template<typename out_t> vector<PCMPCMResampler<out_t>>& get_resamplers();
+	void quantize(void* pcm_data, const float* data, int samples);
+	double get_channel_gain(int ch);
+	double get_dither();
+	void load_stream(uint8_t* dsd_data, int dsd_samples, bool reverse);
+	void reverse_stream(int dsd_samples);
 };
@@ -26,96 +26,131 @@
 using std::conditional_t;
 using std::monostate;
 
-template<typename real_t, int decimation>
+template<typename real_t, int decimation, typename fir1_t = DSDPCMFir<real_t>>
 class DSDPCMConverterMultistage : public DSDPCMConverter<real_t> {
 	using DSDPCMConverter<real_t>::delay;
 	using DSDPCMConverter<real_t>::pcm_temp1;
 	using DSDPCMConverter<real_t>::pcm_temp2;
 	using DSDPCMConverter<real_t>::alloc_pcm_temp1;
 	using DSDPCMConverter<real_t>::alloc_pcm_temp2;
-	conditional_t<decimation >=    8, DSDPCMFir<real_t>, monostate> dsd_fir1;
-	conditional_t<decimation >=   32, PCMPCMFir<real_t>, monostate> pcm_fir2a;
-	conditional_t<decimation >=  128, PCMPCMFir<real_t>, monostate> pcm_fir2b;
-	conditional_t<decimation >=  256, PCMPCMFir<real_t>, monostate> pcm_fir2c;
-	conditional_t<decimation >=  512, PCMPCMFir<real_t>, monostate> pcm_fir2d;
-	conditional_t<decimation >= 1024, PCMPCMFir<real_t>, monostate> pcm_fir2e;
-	conditional_t<decimation >=   16, PCMPCMFir<real_t>, monostate> pcm_fir3;
+	conditional_t<decimation >=    8, fir1_t, monostate> dsd_fir1;
+	conditional_t<decimation >=   32, PCMPCMFirHalfband<real_t>, monostate> pcm_fir2a;
+	conditional_t<decimation >=  128, PCMPCMFirHalfband<real_t>, monostate> pcm_fir2b;
+	conditional_t<decimation >=  256, PCMPCMFirHalfband<real_t>, monostate> pcm_fir2c;
+	conditional_t<decimation >=  512, PCMPCMFirHalfband<real_t>, monostate> pcm_fir2d;
+	conditional_t<decimation >= 1024, PCMPCMFirHalfband<real_t>, monostate> pcm_fir2e;
+	conditional_t<decimation >=   16, PCMPCMFirHalfband<real_t>, monostate> pcm_fir3;
+	int tile_samples;
 public:
 	void init(DSDPCMFilterSetup<real_t>& flt_setup, int dsd_samples) {
+		tile_samples = (dsd_samples < DSD_TILE_SAMPLES) ? dsd_samples : DSD_TILE_SAMPLES;
 		if constexpr (decimation == 1024) {
-			alloc_pcm_temp1(dsd_samples);
-			alloc_pcm_temp2(dsd_samples / 2);
-			dsd_fir1.init(flt_setup.get_fir1_16_ctables(), flt_setup.get_fir1_16_length(), 16);
-			pcm_fir2a.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-			pcm_fir2b.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-			pcm_fir2c.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-			pcm_fir2d.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-			pcm_fir2e.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-			pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2);
+			alloc_pcm_temp1(tile_samples);
+			alloc_pcm_temp2(tile_samples / 2);
+			dsd_fir1.init(flt_setup.get_fir1_16_ctables(), flt_setup.get_fir1_16_length(), 16, flt_setup.get_fir1_16_delay());
+			pcm_fir2a.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2, flt_setup.get_fir2_2_delay());
+			pcm_fir2b.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2, flt_setup.get_fir2_2_delay());
+			pcm_fir2c.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2, flt_setup.get_fir2_2_delay());
+			pcm_fir2d.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2, flt_setup.get_fir2_2_delay());
+			pcm_fir2e.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2, flt_setup.get_fir2_2_delay());
+			pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2, flt_setup.get_fir3_2_delay());
 			delay = (((((dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir2b.get_decimation() + pcm_fir2b.get_delay()) / pcm_fir2c.get_decimation() + pcm_fir2c.get_delay()) / pcm_fir2d.get_decimation() + pcm_fir2d.get_delay()) / pcm_fir2e.get_decimation() + pcm_fir2e.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
 		}
 		if constexpr (decimation == 512) {
-			alloc_pcm_temp1(dsd_samples);
-			alloc_pcm_temp2(dsd_samples / 2);
-			dsd_fir1.init(flt_setup.get_fir1_16_ctables(), flt_setup.get_fir1_16_length(), 16);
-			pcm_fir2a.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-			pcm_fir2b.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-			pcm_fir2c.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-			pcm_fir2d.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-			pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2);
+			alloc_pcm_temp1(tile_samples);
+			alloc_pcm_temp2(tile_samples / 2);
+			dsd_fir1.init(flt_setup.get_fir1_16_ctables(), flt_setup.get_fir1_16_length(), 16, flt_setup.get_fir1_16_delay());
+			pcm_fir2a.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2, flt_setup.get_fir2_2_delay());
+			pcm_fir2b.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2, flt_setup.get_fir2_2_delay());
+			pcm_fir2c.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2, flt_setup.get_fir2_2_delay());
+			pcm_fir2d.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2, flt_setup.get_fir2_2_delay());
+			pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2, flt_setup.get_fir3_2_delay());
 			delay = ((((dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir2b.get_decimation() + pcm_fir2b.get_delay()) / pcm_fir2c.get_decimation() + pcm_fir2c.get_delay()) / pcm_fir2d.get_decimation() + pcm_fir2d.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
 		}
 		if constexpr (decimation == 256) {
-			alloc_pcm_temp1(dsd_samples);
-			alloc_pcm_temp2(dsd_samples / 2);
-			dsd_fir1.init(flt_setup.get_fir1_16_ctables(), flt_setup.get_fir1_16_length(), 16);
-			pcm_fir2a.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-			pcm_fir2b.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-			pcm_fir2c.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-			pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2);
+			alloc_pcm_temp1(tile_samples);
+			alloc_pcm_temp2(tile_samples / 2);
+			dsd_fir1.init(flt_setup.get_fir1_16_ctables(), flt_setup.get_fir1_16_length(), 16, flt_setup.get_fir1_16_delay());
+			pcm_fir2a.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2, flt_setup.get_fir2_2_delay());
+			pcm_fir2b.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2, flt_setup.get_fir2_2_delay());
+			pcm_fir2c.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2, flt_setup.get_fir2_2_delay());
+			pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2, flt_setup.get_fir3_2_delay());
 			delay = (((dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir2b.get_decimation() + pcm_fir2b.get_delay()) / pcm_fir2c.get_decimation() + pcm_fir2c.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
 		}
 		if constexpr (decimation == 128) {
-			alloc_pcm_temp1(dsd_samples);
-			alloc_pcm_temp2(dsd_samples / 2);
-			dsd_fir1.init(flt_setup.get_fir1_16_ctables(), flt_setup.get_fir1_16_length(), 16);
-			pcm_fir2a.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-			pcm_fir2b.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-			pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2);
+			alloc_pcm_temp1(tile_samples);
+			alloc_pcm_temp2(tile_samples / 2);
+			dsd_fir1.init(flt_setup.get_fir1_16_ctables(), flt_setup.get_fir1_16_length(), 16, flt_setup.get_fir1_16_delay());
+			pcm_fir2a.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2, flt_setup.get_fir2_2_delay());
+			pcm_fir2b.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2, flt_setup.get_fir2_2_delay());
+			pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2, flt_setup.get_fir3_2_delay());
 			delay = ((dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir2b.get_decimation() + pcm_fir2b.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
 		}
 		if constexpr (decimation == 64) {
-			alloc_pcm_temp1(dsd_samples);
-			alloc_pcm_temp2(dsd_samples / 2);
-			dsd_fir1.init(flt_setup.get_fir1_16_ctables(), flt_setup.get_fir1_16_length(), 16);
-			pcm_fir2a.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-			pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2);
+			alloc_pcm_temp1(tile_samples);
+			alloc_pcm_temp2(tile_samples / 2);
+			dsd_fir1.init(flt_setup.get_fir1_16_ctables(), flt_setup.get_fir1_16_length(), 16, flt_setup.get_fir1_16_delay());
+			pcm_fir2a.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2, flt_setup.get_fir2_2_delay());
+			pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2, flt_setup.get_fir3_2_delay());
 			delay = (dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
 		}
 		if constexpr (decimation == 32) {
-			alloc_pcm_temp1(dsd_samples);
-			alloc_pcm_temp2(dsd_samples / 2);
-			dsd_fir1.init(flt_setup.get_fir1_8_ctables(), flt_setup.get_fir1_8_length(), 8);
-			pcm_fir2a.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-			pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2);
+			alloc_pcm_temp1(tile_samples);
+			alloc_pcm_temp2(tile_samples / 2);
+			dsd_fir1.init(flt_setup.get_fir1_8_ctables(), flt_setup.get_fir1_8_length(), 8, flt_setup.get_fir1_8_delay());
+			pcm_fir2a.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2, flt_setup.get_fir2_2_delay());
+			pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2, flt_setup.get_fir3_2_delay());
 			delay = (dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
 		}
 		if constexpr (decimation == 16) {
-			alloc_pcm_temp1(dsd_samples);
-			dsd_fir1.init(flt_setup.get_fir1_8_ctables(), flt_setup.get_fir1_8_length(), 8);
-			pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2);
+			alloc_pcm_temp1(tile_samples);
+			dsd_fir1.init(flt_setup.get_fir1_8_ctables(), flt_setup.get_fir1_8_length(), 8, flt_setup.get_fir1_8_delay());
+			pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2, flt_setup.get_fir3_2_delay());
 			delay = dsd_fir1.get_delay() / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
 		}
 		if constexpr (decimation == 8) {
-			(void)dsd_samples;
-			dsd_fir1.init(flt_setup.get_fir1_8_ctables(), flt_setup.get_fir1_8_length(), 8);
+			dsd_fir1.init(flt_setup.get_fir1_8_ctables(), flt_setup.get_fir1_8_length(), 8, flt_setup.get_fir1_8_delay());
 			delay = dsd_fir1.get_delay();
 		}
 	}
-	int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples) {
+	int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples, int dsd_stride) {
+		// Tiles are pushed through the whole cascade while the intermediate samples are still in cache
+		auto pcm_samples = 0;
+		for (auto sample = 0; sample < dsd_samples; sample += tile_samples) {
+			auto samples = (tile_samples < dsd_samples - sample) ? tile_samples : dsd_samples - sample;
+			pcm_samples += convert_tile(dsd_data + (size_t)sample * dsd_stride, pcm_data + pcm_samples, samples, dsd_stride);
+		}
+		return pcm_samples;
+	}
+	fir1_t& get_fir1() {
+		return dsd_fir1;
+	}
+	void reset() {
+		dsd_fir1.reset();
+		if constexpr (decimation >=   32) {
+			pcm_fir2a.reset();
+		}
+		if constexpr (decimation >=  128) {
+			pcm_fir2b.reset();
+		}
+		if constexpr (decimation >=  256) {
+			pcm_fir2c.reset();
+		}
+		if constexpr (decimation >=  512) {
+			pcm_fir2d.reset();
+		}
+		if constexpr (decimation >= 1024) {
+			pcm_fir2e.reset();
+		}
+		if constexpr (decimation >=   16) {
+			pcm_fir3.reset();
+		}
+	}
+private:
+	int convert_tile(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples, int dsd_stride) {
 		int pcm_samples;
 		if constexpr (decimation == 1024) {
-			pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples);
+			pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples, dsd_stride);
 			pcm_samples = pcm_fir2a.run(pcm_temp1, pcm_temp2, pcm_samples);
 			pcm_samples = pcm_fir2b.run(pcm_temp2, pcm_temp1, pcm_samples);
 			pcm_samples = pcm_fir2c.run(pcm_temp1, pcm_temp2, pcm_samples);
@@ -124,7 +159,7 @@ public:
 			pcm_samples = pcm_fir3.run(pcm_temp2, pcm_data, pcm_samples);
 		}
 		if constexpr (decimation == 512) {
-			pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples);
+			pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples, dsd_stride);
 			pcm_samples = pcm_fir2a.run(pcm_temp1, pcm_temp2, pcm_samples);
 			pcm_samples = pcm_fir2b.run(pcm_temp2, pcm_temp1, pcm_samples);
 			pcm_samples = pcm_fir2c.run(pcm_temp1, pcm_temp2, pcm_samples);
@@ -132,34 +167,34 @@ public:
 			pcm_samples = pcm_fir3.run(pcm_temp1, pcm_data, pcm_samples);
 		}
 		if constexpr (decimation == 256) {
-			pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples);
+			pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples, dsd_stride);
 			pcm_samples = pcm_fir2a.run(pcm_temp1, pcm_temp2, pcm_samples);
 			pcm_samples = pcm_fir2b.run(pcm_temp2, pcm_temp1, pcm_samples);
 			pcm_samples = pcm_fir2c.run(pcm_temp1, pcm_temp2, pcm_samples);
 			pcm_samples = pcm_fir3.run(pcm_temp2, pcm_data, pcm_samples);
 		}
 		if constexpr (decimation == 128) {
-			pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples);
+			pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples, dsd_stride);
 			pcm_samples = pcm_fir2a.run(pcm_temp1, pcm_temp2, pcm_samples);
 			pcm_samples = pcm_fir2b.run(pcm_temp2, pcm_temp1, pcm_samples);
 			pcm_samples = pcm_fir3.run(pcm_temp1, pcm_data, pcm_samples);
 		}
 		if constexpr (decimation == 64) {
-			pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples);
+			pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples, dsd_stride);
 			pcm_samples = pcm_fir2a.run(pcm_temp1, pcm_temp2, pcm_samples);
 			pcm_samples = pcm_fir3.run(pcm_temp2, pcm_data, pcm_samples);
 		}
 		if constexpr (decimation == 32) {
-			pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples);
+			pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples, dsd_stride);
 			pcm_samples = pcm_fir2a.run(pcm_temp1, pcm_temp2, pcm_samples);
 			pcm_samples = pcm_fir3.run(pcm_temp2, pcm_data, pcm_samples);
 		}
 		if constexpr (decimation == 16) {
-			pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples);
+			pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples, dsd_stride);
 			pcm_samples = pcm_fir3.run(pcm_temp1, pcm_data, pcm_samples);
 		}
 		if constexpr (decimation == 8) {
-			pcm_samples = dsd_fir1.run(dsd_data, pcm_data, dsd_samples);
+			pcm_samples = dsd_fir1.run(dsd_data, pcm_data, dsd_samples, dsd_stride);
 		}
 		return pcm_samples;
 	}
@@ -0,0 +1,97 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2021 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+
+#pragma once
+
+#include "DSDPCMUtil.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+using std::shared_ptr;
+using std::weak_ptr;
+
+/*
+* Process-wide cache of filter tables shared by all converter engines.
+* Tables are built once per (filter, phase, coefficients hash) and handed out as read-only shared pointers.
+* The cache only keeps weak references, a table is released as soon as the last filter setup using it lets it go.
+*/
+template<typename real_t>
+class DSDPCMFilterCache {
+public:
+	enum filter_e {
+		DSDFIR1_8    = 0,
+		DSDFIR1_16   = 1,
+		DSDFIR1_64   = 2,
+		DSDFIR1_USER = 3,
+		PCMFIR2_2    = 4,
+		PCMFIR3_2    = 5,
+		PCMRESAMPLER = 6
+	};
+private:
+	using key_t = std::tuple<int, int, uint64_t>;
+	std::mutex cache_mtx;
+	std::map<key_t, weak_ptr<real_t>> cache_tables;
+public:
+	static DSDPCMFilterCache& get_instance() {
+		static DSDPCMFilterCache filter_cache;
+		return filter_cache;
+	}
+	shared_ptr<real_t> get_table(filter_e filter, int phase, uint64_t coefs_hash, size_t table_size, const std::function<void(real_t*)>& build_table) {
+		std::lock_guard<std::mutex> lock(cache_mtx);
+		for (auto it = cache_tables.begin(); it != cache_tables.end();) {
+			if (it->second.expired()) {
+				it = cache_tables.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+		auto& cache_table = cache_tables[key_t(filter, phase, coefs_hash)];
+		auto table = cache_table.lock();
+		if (!table) {
+			table = shared_ptr<real_t>((real_t*)DSDPCMUtil::mem_alloc(table_size * sizeof(real_t)), DSDPCMUtil::mem_free);
+			build_table(table.get());
+			cache_table = table;
+		}
+		return table;
+	}
+	shared_ptr<real_t> find_table(filter_e filter, int phase, uint64_t coefs_hash) {
+		std::lock_guard<std::mutex> lock(cache_mtx);
+		auto it = cache_tables.find(key_t(filter, phase, coefs_hash));
+		return (it != cache_tables.end()) ? it->second.lock() : shared_ptr<real_t>();
+	}
+	void put_table(filter_e filter, int phase, uint64_t coefs_hash, const shared_ptr<real_t>& table) {
+		// Tables built elsewhere (e.g. loaded from disk), the caller keeps them alive for as long as they should be reused
+		std::lock_guard<std::mutex> lock(cache_mtx);
+		cache_tables[key_t(filter, phase, coefs_hash)] = table;
+	}
+	static uint64_t get_hash(const double* coefs, int length) {
+		auto hash = (uint64_t)14695981039346656037ull;
+		auto data = (const uint8_t*)coefs;
+		for (size_t i = 0; i < length * sizeof(double); i++) {
+			hash = (hash ^ data[i]) * 1099511628211ull;
+		}
+		return hash ^ (uint64_t)length;
+	}
+};
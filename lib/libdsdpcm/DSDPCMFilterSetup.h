@@ -20,119 +20,186 @@
 #pragma once
 
 #include "DSDPCMConstants.h"
+#include "DSDPCMFilterCache.h"
+#include "DSDPCMMinPhase.h"
 #include "DSDPCMUtil.h"
 
 #include <math.h>
 
+enum class filter_phase_e {
+	LINEAR  = 0,
+	MINIMUM = 1
+};
+
 template<typename real_t>
 class DSDPCMFilterSetup	{
 	using ctable_t = real_t[256];
-	ctable_t* dsd_fir1_8_ctables;
-	ctable_t* dsd_fir1_16_ctables;
-	ctable_t* dsd_fir1_64_ctables;
-	real_t*   pcm_fir2_2_coefs;
-	real_t*   pcm_fir3_2_coefs;
-	double*   dsd_fir1_64_coefs;
+	using filter_cache_t = DSDPCMFilterCache<real_t>;
+	struct min_phase_t {
+		vector<double> coefs;
+		float delay;
+	};
+	shared_ptr<const real_t> dsd_fir1_8_ctables;
+	shared_ptr<const real_t> dsd_fir1_16_ctables;
+	shared_ptr<const real_t> dsd_fir1_64_ctables;
+	shared_ptr<real_t>       pcm_fir2_2_coefs;
+	shared_ptr<real_t>       pcm_fir3_2_coefs;
+	const double* dsd_fir1_64_coefs;
 	int       dsd_fir1_64_length;
 	bool      dsd_fir1_64_modified;
-	float     dsd_fir1_dB_gain;
-	double    dsd_fir1_gain;
+	filter_phase_e fir_phase;
+	min_phase_t    dsd_fir1_8_min_phase;
+	min_phase_t    dsd_fir1_16_min_phase;
+	min_phase_t    dsd_fir1_64_min_phase;
+	min_phase_t    pcm_fir2_2_min_phase;
+	min_phase_t    pcm_fir3_2_min_phase;
 public:
 	DSDPCMFilterSetup() {
-		dsd_fir1_8_ctables = nullptr;
-		dsd_fir1_16_ctables = nullptr;
-		dsd_fir1_64_ctables = nullptr;
-		pcm_fir2_2_coefs = nullptr;
-		pcm_fir3_2_coefs = nullptr;
 		dsd_fir1_64_coefs = nullptr;
 		dsd_fir1_64_length = 0;
 		dsd_fir1_64_modified = false;
-		dsd_fir1_dB_gain = 0;
-		dsd_fir1_gain = 1;
-	}
-	~DSDPCMFilterSetup() {
-		flush_fir1_ctables();
-		DSDPCMUtil::mem_free(pcm_fir2_2_coefs);
-		DSDPCMUtil::mem_free(pcm_fir3_2_coefs);
-	}
-	void flush_fir1_ctables() {
-		DSDPCMUtil::mem_free(dsd_fir1_8_ctables);
-		dsd_fir1_8_ctables = nullptr;
-		DSDPCMUtil::mem_free(dsd_fir1_16_ctables);
-		dsd_fir1_16_ctables = nullptr;
-		DSDPCMUtil::mem_free(dsd_fir1_64_ctables);
-		dsd_fir1_64_ctables = nullptr;
+		fir_phase = filter_phase_e::LINEAR;
 	}
 	static double NORM_I(const int scale = 0) {
 		return (double)1 / (double)((unsigned int)1 << (31 - scale));
 	}
-	ctable_t* get_fir1_8_ctables() {
+	const ctable_t* get_fir1_8_ctables() {
 		if (!dsd_fir1_8_ctables) {
-			dsd_fir1_8_ctables = (ctable_t*)DSDPCMUtil::mem_alloc(CTABLES(DSDFIR1_8_LENGTH) * sizeof(ctable_t));
-			set_ctables(DSDFIR1_8_COEFS, DSDFIR1_8_LENGTH, NORM_I(3) * dsd_fir1_gain , dsd_fir1_8_ctables);
+			dsd_fir1_8_ctables = get_ctables(filter_cache_t::DSDFIR1_8, get_fir_coefs(dsd_fir1_8_min_phase, DSDFIR1_8_COEFS, DSDFIR1_8_LENGTH), DSDFIR1_8_LENGTH, NORM_I(3), DSDFIR1_8_CTABLES<real_t>.ctables);
 		}
-		return dsd_fir1_8_ctables;
+		return (const ctable_t*)dsd_fir1_8_ctables.get();
 	}
 	int get_fir1_8_length() {
 		return DSDFIR1_8_LENGTH;
 	}
-	ctable_t* get_fir1_16_ctables() {
+	float get_fir1_8_delay() {
+		return get_fir_delay(dsd_fir1_8_min_phase, DSDFIR1_8_COEFS, DSDFIR1_8_LENGTH);
+	}
+	const ctable_t* get_fir1_16_ctables() {
 		if (!dsd_fir1_16_ctables) {
-			dsd_fir1_16_ctables = (ctable_t*)DSDPCMUtil::mem_alloc(CTABLES(DSDFIR1_16_LENGTH) * sizeof(ctable_t));
-			set_ctables(DSDFIR1_16_COEFS, DSDFIR1_16_LENGTH, NORM_I(3) * dsd_fir1_gain, dsd_fir1_16_ctables);
+			dsd_fir1_16_ctables = get_ctables(filter_cache_t::DSDFIR1_16, get_fir_coefs(dsd_fir1_16_min_phase, DSDFIR1_16_COEFS, DSDFIR1_16_LENGTH), DSDFIR1_16_LENGTH, NORM_I(3), DSDFIR1_16_CTABLES<real_t>.ctables);
 		}
-		return dsd_fir1_16_ctables;
+		return (const ctable_t*)dsd_fir1_16_ctables.get();
 	}
 	int get_fir1_16_length() {
 		return DSDFIR1_16_LENGTH;
 	}
-	ctable_t* get_fir1_64_ctables() {
-		if (dsd_fir1_64_modified && dsd_fir1_64_coefs && dsd_fir1_64_length > 0) {
-			DSDPCMUtil::mem_free(dsd_fir1_64_ctables);
-			dsd_fir1_64_ctables = (ctable_t*)DSDPCMUtil::mem_alloc(CTABLES(dsd_fir1_64_length) * sizeof(ctable_t));
-			set_ctables(dsd_fir1_64_coefs, dsd_fir1_64_length, dsd_fir1_gain, dsd_fir1_64_ctables);
+	float get_fir1_16_delay() {
+		return get_fir_delay(dsd_fir1_16_min_phase, DSDFIR1_16_COEFS, DSDFIR1_16_LENGTH);
+	}
+	const ctable_t* get_fir1_64_ctables() {
+		if (dsd_fir1_64_modified) {
+			dsd_fir1_64_ctables.reset();
 			dsd_fir1_64_modified = false;
 		}
 		if (!dsd_fir1_64_ctables) {
-			dsd_fir1_64_ctables = (ctable_t*)DSDPCMUtil::mem_alloc(CTABLES(DSDFIR1_64_LENGTH) * sizeof(ctable_t));
-			set_ctables(DSDFIR1_64_COEFS, DSDFIR1_64_LENGTH, NORM_I() * dsd_fir1_gain, dsd_fir1_64_ctables);
+			if (dsd_fir1_64_coefs && dsd_fir1_64_length > 0) {
+				dsd_fir1_64_ctables = get_ctables(filter_cache_t::DSDFIR1_USER, dsd_fir1_64_coefs, dsd_fir1_64_length, 1.0);
+			}
+			else {
+				dsd_fir1_64_ctables = get_ctables(filter_cache_t::DSDFIR1_64, get_fir_coefs(dsd_fir1_64_min_phase, DSDFIR1_64_COEFS, DSDFIR1_64_LENGTH), DSDFIR1_64_LENGTH, NORM_I(), DSDFIR1_64_CTABLES<real_t>.ctables);
+			}
 		}
-		return dsd_fir1_64_ctables;
+		return (const ctable_t*)dsd_fir1_64_ctables.get();
 	}
 	int get_fir1_64_length() {
 		return (dsd_fir1_64_coefs && dsd_fir1_64_length > 0) ? dsd_fir1_64_length : DSDFIR1_64_LENGTH;
 	}
+	float get_fir1_64_delay() {
+		// User filters are taken as they are
+		if (dsd_fir1_64_coefs && dsd_fir1_64_length > 0) {
+			return (float)(dsd_fir1_64_length - 1) / 2;
+		}
+		return get_fir_delay(dsd_fir1_64_min_phase, DSDFIR1_64_COEFS, DSDFIR1_64_LENGTH);
+	}
 	real_t* get_fir2_2_coefs() {
 		if (!pcm_fir2_2_coefs) {
-			pcm_fir2_2_coefs = (real_t*)DSDPCMUtil::mem_alloc(PCMFIR2_2_LENGTH * sizeof(real_t));
-			set_coefs(PCMFIR2_2_COEFS, PCMFIR2_2_LENGTH, NORM_I(), pcm_fir2_2_coefs);
+			pcm_fir2_2_coefs = get_coefs(filter_cache_t::PCMFIR2_2, get_fir_coefs(pcm_fir2_2_min_phase, PCMFIR2_2_COEFS, PCMFIR2_2_LENGTH), PCMFIR2_2_LENGTH, NORM_I());
 		}
-		return pcm_fir2_2_coefs;
+		return pcm_fir2_2_coefs.get();
 	}
 	int get_fir2_2_length() {
 		return PCMFIR2_2_LENGTH;
 	}
+	float get_fir2_2_delay() {
+		return get_fir_delay(pcm_fir2_2_min_phase, PCMFIR2_2_COEFS, PCMFIR2_2_LENGTH);
+	}
 	real_t* get_fir3_2_coefs() {
 		if (!pcm_fir3_2_coefs) {
-			pcm_fir3_2_coefs = (real_t*)DSDPCMUtil::mem_alloc(PCMFIR3_2_LENGTH * sizeof(real_t));
-			set_coefs(PCMFIR3_2_COEFS, PCMFIR3_2_LENGTH, NORM_I(), pcm_fir3_2_coefs);
+			pcm_fir3_2_coefs = get_coefs(filter_cache_t::PCMFIR3_2, get_fir_coefs(pcm_fir3_2_min_phase, PCMFIR3_2_COEFS, PCMFIR3_2_LENGTH), PCMFIR3_2_LENGTH, NORM_I());
 		}
-		return pcm_fir3_2_coefs;
+		return pcm_fir3_2_coefs.get();
 	}
 	int get_fir3_2_length() {
 		return PCMFIR3_2_LENGTH;
 	}
-	void set_fir1_64_coefs(double* fir_coefs, int fir_length) {
+	float get_fir3_2_delay() {
+		return get_fir_delay(pcm_fir3_2_min_phase, PCMFIR3_2_COEFS, PCMFIR3_2_LENGTH);
+	}
+	void set_fir1_64_coefs(const double* fir_coefs, int fir_length) {
 		dsd_fir1_64_modified = dsd_fir1_64_coefs || fir_coefs;
 		dsd_fir1_64_coefs = fir_coefs;
 		dsd_fir1_64_length = fir_length;
 	}
-	void set_gain(float dB_gain) {
-		flush_fir1_ctables();
-		dsd_fir1_dB_gain = dB_gain;
-		dsd_fir1_gain = pow((real_t)10, dsd_fir1_dB_gain / (real_t)20);
+	filter_phase_e get_phase() {
+		return fir_phase;
+	}
+	void set_phase(filter_phase_e phase) {
+		if (phase != fir_phase) {
+			dsd_fir1_8_ctables.reset();
+			dsd_fir1_16_ctables.reset();
+			dsd_fir1_64_ctables.reset();
+			pcm_fir2_2_coefs.reset();
+			pcm_fir3_2_coefs.reset();
+			fir_phase = phase;
+		}
 	}
 private:
+	const double* get_fir_coefs(min_phase_t& min_phase, const double* fir_coefs, const int fir_length) {
+		if (fir_phase == filter_phase_e::LINEAR) {
+			return fir_coefs;
+		}
+		if (min_phase.coefs.empty()) {
+			// Designed once per setup at runtime, the tables built from it go through the filter cache
+			min_phase.coefs.resize(fir_length);
+			DSDPCMMinPhase::make_min_phase(fir_coefs, fir_length, min_phase.coefs.data());
+			min_phase.delay = DSDPCMMinPhase::get_delay(min_phase.coefs.data(), fir_length);
+		}
+		return min_phase.coefs.data();
+	}
+	float get_fir_delay(min_phase_t& min_phase, const double* fir_coefs, const int fir_length) {
+		if (fir_phase == filter_phase_e::LINEAR) {
+			return (float)(fir_length - 1) / 2;
+		}
+		get_fir_coefs(min_phase, fir_coefs, fir_length);
+		return min_phase.delay;
+	}
+	shared_ptr<const real_t> get_ctables(typename filter_cache_t::filter_e filter, const double* fir_coefs, const int fir_length, const double fir_norm, const ctable_t* unity_ctables = nullptr) {
+		if (unity_ctables && fir_phase == filter_phase_e::LINEAR) {
+			// Tables generated at compile time are not owned by anybody
+			return shared_ptr<const real_t>(shared_ptr<const real_t>(), &unity_ctables[0][0]);
+		}
+		auto coefs_hash = (filter == filter_cache_t::DSDFIR1_USER) ? filter_cache_t::get_hash(fir_coefs, fir_length) : 0;
+		auto fir_gain = fir_norm;
+		// A filter whose table sum leaves the fixed point accumulator range (user filters with a tap magnitude sum above 8) is scaled down to fit
+		auto fir_sum = 0.0;
+		for (auto i = 0; i < fir_length; i++) {
+			fir_sum += fabs(fir_coefs[i] * fir_gain);
+		}
+		auto max_sum = DSDPCMSample<real_t>::max_ctable_sum(CTABLES(fir_length));
+		if (fir_sum > max_sum) {
+			fir_gain *= max_sum / fir_sum;
+		}
+		auto phase = (filter == filter_cache_t::DSDFIR1_USER) ? filter_phase_e::LINEAR : fir_phase;
+		return filter_cache_t::get_instance().get_table(filter, (int)phase, coefs_hash, CTABLES(fir_length) * 256, [&](real_t* table) {
+			set_ctables(fir_coefs, fir_length, fir_gain, (ctable_t*)table);
+		});
+	}
+	shared_ptr<real_t> get_coefs(typename filter_cache_t::filter_e filter, const double* fir_coefs, const int fir_length, const double fir_norm) {
+		return filter_cache_t::get_instance().get_table(filter, (int)fir_phase, 0, fir_length, [&](real_t* table) {
+			set_coefs(fir_coefs, fir_length, fir_norm, table);
+		});
+	}
 	int set_ctables(const double* fir_coefs, const int fir_length, const double fir_gain, ctable_t* out_ctables) {
 		int ctables = CTABLES(fir_length);
 		for (int ct = 0; ct < ctables; ct++) {
@@ -148,14 +215,14 @@ private:
 				for (int j = 0; j < k; j++) {
 					cvalue += (((i >> (7 - j)) & 1) * 2 - 1) * fir_coefs[fir_length - 1 - (ct * 8 + j)];
 				}
-				out_ctables[ct][i] = (real_t)(cvalue * fir_gain);
+				out_ctables[ct][i] = DSDPCMSample<real_t>::from_sample(cvalue * fir_gain);
 			}
 		}
 		return ctables;
 	}
 	void set_coefs(const double* fir_coefs, const int fir_length, const double fir_gain, real_t* out_coefs) {
 		for (int i = 0; i < fir_length; i++) {
-			out_coefs[i] = (real_t)(fir_coefs[fir_length - 1 - i] * fir_gain);
+			out_coefs[i] = DSDPCMSample<real_t>::from_coef(fir_coefs[fir_length - 1 - i] * fir_gain);
 		}
 	}
 };
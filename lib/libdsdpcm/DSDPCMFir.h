@@ -20,63 +20,89 @@
 #pragma once
 
 #include "DSDPCMConstants.h"
+#include "DSDPCMFirHistory.h"
+#include "DSDPCMFirKernel.h"
 #include "DSDPCMUtil.h"
 
 template<typename real_t>
 class DSDPCMFir {
 	using ctable_t = real_t[256];
-	ctable_t* fir_ctables;
+	const ctable_t* fir_ctables;
 	int       fir_order;
+	float     fir_delay;
 	int       fir_length;
 	int       decimation;
-	uint8_t*  fir_buffer;
-	int       fir_index;
+	DSDPCMFirHistory<uint8_t> fir_history;
+	uint8_t*  fir_tile;
+	typename DSDPCMFirKernel<real_t>::accumulate_t fir_accumulate;
 public:
 	DSDPCMFir() {
 		fir_ctables = nullptr;
 		fir_order = 0;
+		fir_delay = 0.0f;
 		fir_length = 0;
 		decimation = 1;
-		fir_buffer = nullptr;
-		fir_index = 0;
+		fir_tile = nullptr;
+		fir_accumulate = nullptr;
 	}
 	~DSDPCMFir() {
 		free();
 	}
-	void init(ctable_t* p_fir_ctables, int p_fir_length, int p_decimation) {
+	void init(const ctable_t* p_fir_ctables, int p_fir_length, int p_decimation, float p_fir_delay) {
 		fir_ctables = p_fir_ctables;
 		fir_order = p_fir_length - 1;
+		fir_delay = p_fir_delay;
 		fir_length = CTABLES(p_fir_length);
 		decimation = p_decimation / 8;
-		auto buf_size = 2 * fir_length * sizeof(uint8_t);
-		fir_buffer = (uint8_t*)DSDPCMUtil::mem_alloc(buf_size);
-		memset(fir_buffer, DSD_SILENCE_BYTE, buf_size);
-		fir_index = 0;
+		fir_history.init(fir_length, DSD_SILENCE_BYTE);
+		fir_tile = (uint8_t*)DSDPCMUtil::mem_alloc(DSD_TILE_SAMPLES * sizeof(uint8_t));
+		fir_accumulate = DSDPCMFirKernel<real_t>::get_accumulate(fir_length);
 	}
 	void free() {
-		if (fir_buffer) {
-			DSDPCMUtil::mem_free(fir_buffer);
-			fir_buffer = nullptr;
-		}
+		fir_history.free();
+		DSDPCMUtil::mem_free(fir_tile);
+		fir_tile = nullptr;
+	}
+	void reset() {
+		fir_history.reset();
 	}
 	int get_decimation() {
 		return decimation;
 	}
 	float get_delay() {
-		return (float)fir_order / 2 / 8 / decimation;
+		return fir_delay / 8 / decimation;
 	}
-	int run(uint8_t* p_dsd_data, real_t* p_pcm_data, int p_dsd_samples) {
+	int run(uint8_t* p_dsd_data, real_t* p_pcm_data, int p_dsd_samples, int p_dsd_stride) {
+		if (p_dsd_stride == 1) {
+			return run(p_dsd_data, p_pcm_data, p_dsd_samples);
+		}
+		// Interleaved input is split into a cache sized tile right before it is convolved
 		auto pcm_samples = p_dsd_samples / decimation;
-		for (auto sample = 0; sample < pcm_samples; sample++) {
-			for (auto i = 0; i < decimation; i++) {
-				fir_buffer[fir_index + fir_length] = fir_buffer[fir_index] = *(p_dsd_data++);
-				fir_index = (++fir_index) % fir_length;
-			}
-			p_pcm_data[sample] = (real_t)0;
-			for (auto j = 0; j < fir_length; j++) {
-				p_pcm_data[sample] += fir_ctables[j][fir_buffer[fir_index + j]];
+		auto tile_outputs = DSD_TILE_SAMPLES / decimation;
+		auto tile_data = fir_tile;
+		for (auto sample = 0; sample < pcm_samples; sample += tile_outputs) {
+			auto tile_samples = ((tile_outputs < pcm_samples - sample) ? tile_outputs : pcm_samples - sample) * decimation;
+			auto dsd_data = p_dsd_data + (size_t)sample * decimation * p_dsd_stride;
+			for (auto i = 0; i < tile_samples; i++) {
+				tile_data[i] = dsd_data[i * p_dsd_stride];
 			}
+			run(tile_data, p_pcm_data + sample, tile_samples);
+		}
+		return pcm_samples;
+	}
+	int run(uint8_t* p_dsd_data, real_t* p_pcm_data, int p_dsd_samples) {
+		auto pcm_samples = p_dsd_samples / decimation;
+		auto dsd_samples = pcm_samples * decimation;
+		auto head_samples = fir_history.get_head_outputs(pcm_samples, decimation);
+		auto head_data = fir_history.stage(p_dsd_data, dsd_samples);
+		auto offset = decimation - fir_length;
+		for (auto sample = 0; sample < head_samples; sample++) {
+			p_pcm_data[sample] = fir_accumulate(fir_ctables, head_data + sample * decimation + offset, fir_length);
+		}
+		for (auto sample = head_samples; sample < pcm_samples; sample++) {
+			p_pcm_data[sample] = fir_accumulate(fir_ctables, p_dsd_data + sample * decimation + offset, fir_length);
 		}
+		fir_history.save(p_dsd_data, dsd_samples);
 		return pcm_samples;
 	}
 };
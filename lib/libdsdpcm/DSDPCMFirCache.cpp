@@ -0,0 +1,251 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2021 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+
+#include "DSDPCMFirCache.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr uint32_t FIRCACHE_MAGIC = 0x52494644; // "DFIR"
+constexpr uint32_t FIRCACHE_VERSION = 2;
+constexpr size_t   FIRCACHE_ALIGN = 64;
+
+struct fir_cache_header_t {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t file_hash;
+	int32_t  precision;
+	int32_t  real_size;
+	int32_t  fir_length;
+	int32_t  name_length;
+	uint32_t reserved;
+	uint64_t ctables_offset;
+	uint64_t ctables_size;
+};
+
+size_t align_offset(size_t offset) {
+	return (offset + FIRCACHE_ALIGN - 1) & ~(FIRCACHE_ALIGN - 1);
+}
+
+size_t get_real_size(conv_precision_e precision) {
+	switch (precision) {
+	case conv_precision_e::FP64:
+		return sizeof(double);
+	case conv_precision_e::INT32:
+		return sizeof(int32_t);
+	default:
+		return sizeof(float);
+	}
+}
+
+template<typename real_t>
+shared_ptr<void> put_ctables(const shared_ptr<uint8_t>& map_data, size_t ctables_offset, const double* coefs, int length) {
+	using filter_cache_t = DSDPCMFilterCache<real_t>;
+	// Shares ownership of the mapping, it stays mapped while any filter setup uses the tables
+	auto ctables = shared_ptr<real_t>(map_data, (real_t*)(map_data.get() + ctables_offset));
+	filter_cache_t::get_instance().put_table(filter_cache_t::DSDFIR1_USER, (int)filter_phase_e::LINEAR, filter_cache_t::get_hash(coefs, length), ctables);
+	return ctables;
+}
+
+template<typename real_t>
+shared_ptr<void> find_ctables(const double* coefs, int length) {
+	using filter_cache_t = DSDPCMFilterCache<real_t>;
+	return filter_cache_t::get_instance().find_table(filter_cache_t::DSDFIR1_USER, (int)filter_phase_e::LINEAR, filter_cache_t::get_hash(coefs, length));
+}
+
+shared_ptr<uint8_t> map_file(const std::string& path, size_t& size) {
+	size = 0;
+#ifdef _WIN32
+	auto wpath_length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+	std::wstring wpath(wpath_length, L'\0');
+	MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &wpath[0], wpath_length);
+	auto file = CreateFileW(wpath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return nullptr;
+	}
+	LARGE_INTEGER file_size;
+	HANDLE mapping = nullptr;
+	void* data = nullptr;
+	if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+		mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	}
+	if (mapping) {
+		data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+	if (!data) {
+		return nullptr;
+	}
+	size = (size_t)file_size.QuadPart;
+	return shared_ptr<uint8_t>((uint8_t*)data, [](uint8_t* p) { UnmapViewOfFile(p); });
+#else
+	auto fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return nullptr;
+	}
+	struct stat st;
+	void* data = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_size > 0) {
+		data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	close(fd);
+	if (data == MAP_FAILED) {
+		return nullptr;
+	}
+	size = (size_t)st.st_size;
+	auto map_size = size;
+	return shared_ptr<uint8_t>((uint8_t*)data, [map_size](uint8_t* p) { munmap(p, map_size); });
+#endif
+}
+
+}
+
+DSDPCMFirCache::DSDPCMFirCache() {
+	fir_coefs = nullptr;
+	fir_length = 0;
+}
+
+DSDPCMFirCache::~DSDPCMFirCache() {
+	free();
+}
+
+uint64_t DSDPCMFirCache::get_hash(const void* data, size_t size) {
+	auto hash = (uint64_t)14695981039346656037ull;
+	auto bytes = (const uint8_t*)data;
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash ^ (uint64_t)size;
+}
+
+std::string DSDPCMFirCache::get_file_name(uint64_t file_hash, conv_precision_e precision) {
+	char name[64];
+	snprintf(name, sizeof(name), "fir_%016llx_%d.bin", (unsigned long long)file_hash, (int)precision);
+	return name;
+}
+
+bool DSDPCMFirCache::load(const std::string& path, uint64_t file_hash, conv_precision_e precision) {
+	free();
+	size_t map_size;
+	auto data = map_file(path, map_size);
+	if (!data || map_size < sizeof(fir_cache_header_t)) {
+		return false;
+	}
+	auto header = (const fir_cache_header_t*)data.get();
+	if (header->magic != FIRCACHE_MAGIC || header->version != FIRCACHE_VERSION || header->file_hash != file_hash) {
+		return false;
+	}
+	if (header->precision != (int32_t)precision || header->real_size != (int32_t)get_real_size(precision) || header->fir_length <= 0 || header->name_length < 0) {
+		return false;
+	}
+	auto coefs_offset = align_offset(sizeof(fir_cache_header_t));
+	auto name_offset = coefs_offset + header->fir_length * sizeof(double);
+	auto ctables_size = CTABLES(header->fir_length) * 256 * get_real_size(precision);
+	if (header->ctables_offset < name_offset + header->name_length || header->ctables_size != ctables_size || header->ctables_offset + header->ctables_size > map_size) {
+		return false;
+	}
+	fir_coefs = (const double*)(data.get() + coefs_offset);
+	fir_length = header->fir_length;
+	fir_name.assign((const char*)data.get() + name_offset, header->name_length);
+	switch (precision) {
+	case conv_precision_e::FP64:
+		map_ctables = put_ctables<double>(data, header->ctables_offset, fir_coefs, fir_length);
+		break;
+	case conv_precision_e::INT32:
+		map_ctables = put_ctables<int32_t>(data, header->ctables_offset, fir_coefs, fir_length);
+		break;
+	default:
+		map_ctables = put_ctables<float>(data, header->ctables_offset, fir_coefs, fir_length);
+		break;
+	}
+	map_data = data;
+	return true;
+}
+
+bool DSDPCMFirCache::save(const std::string& path, uint64_t file_hash, conv_precision_e precision, const double* coefs, int length, const std::string& name) {
+	// The tables are taken from the filter cache, so this is called after a converter has been initialised with the coefficients
+	shared_ptr<void> ctables;
+	switch (precision) {
+	case conv_precision_e::FP64:
+		ctables = find_ctables<double>(coefs, length);
+		break;
+	case conv_precision_e::INT32:
+		ctables = find_ctables<int32_t>(coefs, length);
+		break;
+	default:
+		ctables = find_ctables<float>(coefs, length);
+		break;
+	}
+	if (!ctables || length <= 0) {
+		return false;
+	}
+	fir_cache_header_t header;
+	memset(&header, 0, sizeof(header));
+	header.magic = FIRCACHE_MAGIC;
+	header.version = FIRCACHE_VERSION;
+	header.file_hash = file_hash;
+	header.precision = (int32_t)precision;
+	header.real_size = (int32_t)get_real_size(precision);
+	header.fir_length = length;
+	header.name_length = (int32_t)name.size();
+	auto coefs_offset = align_offset(sizeof(fir_cache_header_t));
+	auto name_offset = coefs_offset + length * sizeof(double);
+	header.ctables_offset = align_offset(name_offset + name.size());
+	header.ctables_size = CTABLES(length) * 256 * get_real_size(precision);
+	// Written under a temporary name first, a partially written file is never picked up by load()
+	auto temp_path = path + ".tmp";
+	auto file = fopen(temp_path.c_str(), "wb");
+	if (!file) {
+		return false;
+	}
+	static const uint8_t padding[FIRCACHE_ALIGN] = {};
+	auto ok = fwrite(&header, sizeof(header), 1, file) == 1;
+	ok = ok && fwrite(padding, 1, coefs_offset - sizeof(header), file) == coefs_offset - sizeof(header);
+	ok = ok && fwrite(coefs, sizeof(double), length, file) == (size_t)length;
+	ok = ok && fwrite(name.data(), 1, name.size(), file) == name.size();
+	ok = ok && fwrite(padding, 1, header.ctables_offset - name_offset - name.size(), file) == header.ctables_offset - name_offset - name.size();
+	ok = ok && fwrite(ctables.get(), 1, header.ctables_size, file) == header.ctables_size;
+	ok = (fclose(file) == 0) && ok;
+	if (!ok || rename(temp_path.c_str(), path.c_str()) != 0) {
+		remove(temp_path.c_str());
+		return false;
+	}
+	return true;
+}
+
+void DSDPCMFirCache::free() {
+	map_ctables.reset();
+	map_data.reset();
+	fir_coefs = nullptr;
+	fir_length = 0;
+	fir_name.clear();
+}
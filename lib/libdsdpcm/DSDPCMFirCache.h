@@ -0,0 +1,62 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2021 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+
+#pragma once
+
+#include "DSDPCMConverter.h"
+
+#include <memory>
+#include <string>
+
+using std::shared_ptr;
+
+/*
+* Compiled form of a user FIR file: the parsed coefficients followed by the lookup tables built from them
+* for one converter precision. The file is mapped into memory and its tables are registered with DSDPCMFilterCache,
+* so a converter initialised with get_coefs() neither parses the text file nor regenerates the tables.
+* Cache files are named by the hash of the FIR file and the precision, a changed FIR gets a new file.
+*/
+class DSDPCMFirCache {
+	shared_ptr<uint8_t> map_data;
+	shared_ptr<void>    map_ctables;
+	const double*       fir_coefs;
+	int                 fir_length;
+	std::string         fir_name;
+public:
+	DSDPCMFirCache();
+	~DSDPCMFirCache();
+	static uint64_t get_hash(const void* data, size_t size);
+	static std::string get_file_name(uint64_t file_hash, conv_precision_e precision);
+	bool load(const std::string& path, uint64_t file_hash, conv_precision_e precision);
+	static bool save(const std::string& path, uint64_t file_hash, conv_precision_e precision, const double* coefs, int length, const std::string& name);
+	void free();
+	bool is_loaded() const {
+		return map_data != nullptr;
+	}
+	const double* get_coefs() const {
+		return fir_coefs;
+	}
+	int get_length() const {
+		return fir_length;
+	}
+	const std::string& get_name() const {
+		return fir_name;
+	}
+};
@@ -0,0 +1,173 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2021 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+
+#pragma once
+
+#include "DSDPCMConstants.h"
+#include "DSDPCMFirKernel.h"
+#include "DSDPCMUtil.h"
+
+/*
+* First DSD filter stage run for all channels of a stream in one pass.
+* The DSD bytes of up to LANES channels are interleaved into a tile, one entry per channel for each table,
+* so a single gather per table fetches the values of the whole group. All channels share the same tables.
+* The outputs of the block are kept per channel and picked up by the per channel cascades through DSDPCMFirLane.
+*/
+template<typename real_t>
+class DSDPCMFirChannels {
+	using ctable_t = real_t[256];
+	using kernel_t = DSDPCMFirKernel<real_t>;
+	static constexpr int LANES = kernel_t::LANES;
+	const ctable_t* fir_ctables;
+	int       fir_length;
+	int       decimation;
+	int       channels;
+	int       groups;
+	int       tile_size;
+	uint8_t*  fir_tiles;
+	real_t*   fir_data;
+	int       fir_stride;
+	typename kernel_t::accumulate_lanes_t fir_accumulate;
+public:
+	DSDPCMFirChannels() {
+		fir_ctables = nullptr;
+		fir_length = 0;
+		decimation = 1;
+		channels = 0;
+		groups = 0;
+		tile_size = 0;
+		fir_tiles = nullptr;
+		fir_data = nullptr;
+		fir_stride = 0;
+		fir_accumulate = nullptr;
+	}
+	~DSDPCMFirChannels() {
+		free();
+	}
+	void init(const ctable_t* p_fir_ctables, int p_fir_length, int p_decimation, int p_channels, int p_dsd_samples) {
+		free();
+		fir_ctables = p_fir_ctables;
+		fir_length = CTABLES(p_fir_length);
+		decimation = p_decimation / 8;
+		channels = p_channels;
+		groups = (channels + LANES - 1) / LANES;
+		// Each tile starts with the last fir_length samples of the previous one
+		tile_size = (fir_length + DSD_TILE_SAMPLES) * LANES;
+		fir_tiles = (uint8_t*)DSDPCMUtil::mem_alloc(groups * tile_size * sizeof(uint8_t));
+		fir_stride = p_dsd_samples / decimation;
+		fir_data = (real_t*)DSDPCMUtil::mem_alloc(channels * fir_stride * sizeof(real_t));
+		fir_accumulate = kernel_t::get_accumulate_lanes();
+		reset();
+	}
+	void free() {
+		DSDPCMUtil::mem_free(fir_tiles);
+		fir_tiles = nullptr;
+		DSDPCMUtil::mem_free(fir_data);
+		fir_data = nullptr;
+	}
+	void reset() {
+		// Lanes past the last channel stay silent for good
+		memset(fir_tiles, DSD_SILENCE_BYTE, groups * tile_size * sizeof(uint8_t));
+	}
+	const real_t* get_data(int ch) {
+		return fir_data + ch * fir_stride;
+	}
+	int run(const uint8_t* p_dsd_data, int p_dsd_samples, int p_dsd_stride) {
+		auto pcm_samples = p_dsd_samples / decimation;
+		auto tile_outputs = DSD_TILE_SAMPLES / decimation;
+		real_t sums[LANES];
+		for (auto group = 0; group < groups; group++) {
+			auto group_channels = (LANES < channels - group * LANES) ? LANES : channels - group * LANES;
+			auto tile_data = fir_tiles + group * tile_size;
+			auto tile_head = tile_data + fir_length * LANES;
+			for (auto sample = 0; sample < pcm_samples; sample += tile_outputs) {
+				auto outputs = (tile_outputs < pcm_samples - sample) ? tile_outputs : pcm_samples - sample;
+				auto samples = outputs * decimation;
+				auto dsd_data = p_dsd_data + (size_t)sample * decimation * p_dsd_stride + group * LANES;
+				for (auto i = 0; i < samples; i++) {
+					for (auto lane = 0; lane < group_channels; lane++) {
+						tile_head[i * LANES + lane] = dsd_data[i * p_dsd_stride + lane];
+					}
+				}
+				for (auto output = 0; output < outputs; output++) {
+					fir_accumulate(fir_ctables, tile_data + (output + 1) * decimation * LANES, fir_length, sums);
+					for (auto lane = 0; lane < group_channels; lane++) {
+						fir_data[(group * LANES + lane) * fir_stride + sample + output] = sums[lane];
+					}
+				}
+				memmove(tile_data, tile_data + samples * LANES, fir_length * LANES);
+			}
+		}
+		return pcm_samples;
+	}
+};
+
+/*
+* Takes the place of DSDPCMFir as the first stage of a cascade that belongs to a channel group.
+* It records the filter the cascade selects, DSDPCMFirChannels is set up from it, and hands out the outputs computed for its channel.
+*/
+template<typename real_t>
+class DSDPCMFirLane {
+	using ctable_t = real_t[256];
+	const ctable_t* fir_ctables;
+	int       fir_length;
+	float     fir_delay;
+	int       decimation;
+	const real_t* lane_data;
+public:
+	DSDPCMFirLane() {
+		fir_ctables = nullptr;
+		fir_length = 0;
+		fir_delay = 0.0f;
+		decimation = 1;
+		lane_data = nullptr;
+	}
+	void init(const ctable_t* p_fir_ctables, int p_fir_length, int p_decimation, float p_fir_delay) {
+		fir_ctables = p_fir_ctables;
+		fir_length = p_fir_length;
+		fir_delay = p_fir_delay;
+		decimation = p_decimation / 8;
+	}
+	void reset() {
+	}
+	const ctable_t* get_ctables() {
+		return fir_ctables;
+	}
+	int get_length() {
+		return fir_length;
+	}
+	int get_decimation() {
+		return decimation;
+	}
+	float get_delay() {
+		return fir_delay / 8 / decimation;
+	}
+	void set_data(const real_t* p_lane_data) {
+		lane_data = p_lane_data;
+	}
+	int run(uint8_t* p_dsd_data, real_t* p_pcm_data, int p_dsd_samples, int p_dsd_stride) {
+		(void)p_dsd_data;
+		(void)p_dsd_stride;
+		auto pcm_samples = p_dsd_samples / decimation;
+		memcpy(p_pcm_data, lane_data, pcm_samples * sizeof(real_t));
+		lane_data += pcm_samples;
+		return pcm_samples;
+	}
+};
@@ -0,0 +1,78 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2021 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+
+#pragma once
+
+#include "DSDPCMUtil.h"
+
+/*
+* History of a FIR filter that convolves straight over the input block.
+* Only the last (length - 1) samples are kept between blocks. Outputs whose window starts before the block
+* are read from the staging buffer, which holds the kept tail followed by the head of the current block.
+*/
+template<typename sample_t>
+class DSDPCMFirHistory {
+	sample_t* buffer;
+	int       tail_length;
+	sample_t  silence;
+public:
+	DSDPCMFirHistory() {
+		buffer = nullptr;
+		tail_length = 0;
+		silence = sample_t();
+	}
+	~DSDPCMFirHistory() {
+		free();
+	}
+	void init(int length, sample_t p_silence) {
+		tail_length = length - 1;
+		silence = p_silence;
+		buffer = (sample_t*)DSDPCMUtil::mem_alloc((2 * tail_length + 1) * sizeof(sample_t));
+		reset();
+	}
+	void reset() {
+		for (auto i = 0; i < 2 * tail_length + 1; i++) {
+			buffer[i] = silence;
+		}
+	}
+	void free() {
+		if (buffer) {
+			DSDPCMUtil::mem_free(buffer);
+			buffer = nullptr;
+		}
+	}
+	int get_head_outputs(int out_samples, int decimation) {
+		auto head_outputs = tail_length / decimation;
+		return (head_outputs < out_samples) ? head_outputs : out_samples;
+	}
+	sample_t* stage(const sample_t* data, int samples) {
+		auto head_samples = (samples < tail_length) ? samples : tail_length;
+		memcpy(buffer + tail_length, data, head_samples * sizeof(sample_t));
+		return buffer + tail_length;
+	}
+	void save(const sample_t* data, int samples) {
+		if (samples >= tail_length) {
+			memcpy(buffer, data + samples - tail_length, tail_length * sizeof(sample_t));
+		}
+		else {
+			memmove(buffer, buffer + samples, tail_length * sizeof(sample_t));
+		}
+	}
+};
@@ -0,0 +1,529 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2021 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "DSDPCMFirKernel.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define DSDPCM_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define DSDPCM_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define DSDPCM_TARGET(isa) __attribute__((target(isa)))
+#else
+#define DSDPCM_TARGET(isa)
+#endif
+
+using ctable32_t = float[256];
+using ctable64_t = double[256];
+using ctablei32_t = int32_t[256];
+
+#ifdef DSDPCM_X86
+
+#if defined(_MSC_VER) && !defined(__clang__)
+static bool cpu_has_xsave_state(unsigned long long mask) {
+	int info[4];
+	__cpuid(info, 1);
+	if (!(info[2] & (1 << 27))) { // OSXSAVE
+		return false;
+	}
+	return (_xgetbv(0) & mask) == mask;
+}
+static bool cpu_has_avx2() {
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7 || !cpu_has_xsave_state(0x06)) {
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+}
+static bool cpu_has_avx512() {
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7 || !cpu_has_xsave_state(0xe6)) {
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 16)) != 0;
+}
+#else
+static bool cpu_has_avx2() {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+static bool cpu_has_avx512() {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx512f");
+}
+#endif
+
+DSDPCM_TARGET("avx2")
+static float accumulate_avx2(const ctable32_t* ctables, const uint8_t* data, int length) {
+	const __m256i offsets = _mm256_slli_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), 8);
+	__m256 acc0 = _mm256_setzero_ps();
+	__m256 acc1 = _mm256_setzero_ps();
+	auto j = 0;
+	for (; j + 16 <= length; j += 16) {
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + j));
+		__m256i index0 = _mm256_add_epi32(_mm256_cvtepu8_epi32(bytes), offsets);
+		__m256i index1 = _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8)), offsets);
+		acc0 = _mm256_add_ps(acc0, _mm256_i32gather_ps(ctables[j + 0], index0, sizeof(float)));
+		acc1 = _mm256_add_ps(acc1, _mm256_i32gather_ps(ctables[j + 8], index1, sizeof(float)));
+	}
+	float tail = 0;
+	for (; j < length; j++) {
+		tail += ctables[j][data[j]];
+	}
+	acc0 = _mm256_add_ps(acc0, acc1);
+	__m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1));
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+	return _mm_cvtss_f32(sum) + tail;
+}
+
+DSDPCM_TARGET("avx2")
+static double accumulate_avx2(const ctable64_t* ctables, const uint8_t* data, int length) {
+	const __m128i offsets = _mm_slli_epi32(_mm_setr_epi32(0, 1, 2, 3), 8);
+	__m256d acc0 = _mm256_setzero_pd();
+	__m256d acc1 = _mm256_setzero_pd();
+	auto j = 0;
+	for (; j + 8 <= length; j += 8) {
+		__m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data + j));
+		__m128i index0 = _mm_add_epi32(_mm_cvtepu8_epi32(bytes), offsets);
+		__m128i index1 = _mm_add_epi32(_mm_cvtepu8_epi32(_mm_srli_si128(bytes, 4)), offsets);
+		acc0 = _mm256_add_pd(acc0, _mm256_i32gather_pd(ctables[j + 0], index0, sizeof(double)));
+		acc1 = _mm256_add_pd(acc1, _mm256_i32gather_pd(ctables[j + 4], index1, sizeof(double)));
+	}
+	double tail = 0;
+	for (; j < length; j++) {
+		tail += ctables[j][data[j]];
+	}
+	acc0 = _mm256_add_pd(acc0, acc1);
+	__m128d sum = _mm_add_pd(_mm256_castpd256_pd128(acc0), _mm256_extractf128_pd(acc0, 1));
+	sum = _mm_add_sd(sum, _mm_unpackhi_pd(sum, sum));
+	return _mm_cvtsd_f64(sum) + tail;
+}
+
+DSDPCM_TARGET("avx2")
+static int32_t accumulate_avx2(const ctablei32_t* ctables, const uint8_t* data, int length) {
+	const __m256i offsets = _mm256_slli_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), 8);
+	__m256i acc0 = _mm256_setzero_si256();
+	__m256i acc1 = _mm256_setzero_si256();
+	auto j = 0;
+	for (; j + 16 <= length; j += 16) {
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + j));
+		__m256i index0 = _mm256_add_epi32(_mm256_cvtepu8_epi32(bytes), offsets);
+		__m256i index1 = _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8)), offsets);
+		acc0 = _mm256_add_epi32(acc0, _mm256_i32gather_epi32(reinterpret_cast<const int*>(ctables[j + 0]), index0, sizeof(int32_t)));
+		acc1 = _mm256_add_epi32(acc1, _mm256_i32gather_epi32(reinterpret_cast<const int*>(ctables[j + 8]), index1, sizeof(int32_t)));
+	}
+	int32_t tail = 0;
+	for (; j < length; j++) {
+		tail += ctables[j][data[j]];
+	}
+	acc0 = _mm256_add_epi32(acc0, acc1);
+	__m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc0), _mm256_extracti128_si256(acc0, 1));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(sum) + tail;
+}
+
+DSDPCM_TARGET("avx512f")
+static float accumulate_avx512(const ctable32_t* ctables, const uint8_t* data, int length) {
+	const __m512i offsets = _mm512_slli_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), 8);
+	__m512 acc = _mm512_setzero_ps();
+	auto j = 0;
+	for (; j + 16 <= length; j += 16) {
+		__m512i index = _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + j)));
+		index = _mm512_add_epi32(index, offsets);
+		acc = _mm512_add_ps(acc, _mm512_i32gather_ps(index, ctables[j], sizeof(float)));
+	}
+	float tail = 0;
+	for (; j < length; j++) {
+		tail += ctables[j][data[j]];
+	}
+	return _mm512_reduce_add_ps(acc) + tail;
+}
+
+DSDPCM_TARGET("avx512f")
+static double accumulate_avx512(const ctable64_t* ctables, const uint8_t* data, int length) {
+	const __m256i offsets = _mm256_slli_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), 8);
+	__m512d acc0 = _mm512_setzero_pd();
+	__m512d acc1 = _mm512_setzero_pd();
+	auto j = 0;
+	for (; j + 16 <= length; j += 16) {
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + j));
+		__m256i index0 = _mm256_add_epi32(_mm256_cvtepu8_epi32(bytes), offsets);
+		__m256i index1 = _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8)), offsets);
+		acc0 = _mm512_add_pd(acc0, _mm512_i32gather_pd(index0, ctables[j + 0], sizeof(double)));
+		acc1 = _mm512_add_pd(acc1, _mm512_i32gather_pd(index1, ctables[j + 8], sizeof(double)));
+	}
+	double tail = 0;
+	for (; j < length; j++) {
+		tail += ctables[j][data[j]];
+	}
+	return _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1)) + tail;
+}
+
+DSDPCM_TARGET("avx512f")
+static int32_t accumulate_avx512(const ctablei32_t* ctables, const uint8_t* data, int length) {
+	const __m512i offsets = _mm512_slli_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), 8);
+	__m512i acc = _mm512_setzero_si512();
+	auto j = 0;
+	for (; j + 16 <= length; j += 16) {
+		__m512i index = _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + j)));
+		index = _mm512_add_epi32(index, offsets);
+		acc = _mm512_add_epi32(acc, _mm512_i32gather_epi32(index, ctables[j], sizeof(int32_t)));
+	}
+	int32_t tail = 0;
+	for (; j < length; j++) {
+		tail += ctables[j][data[j]];
+	}
+	return _mm512_reduce_add_epi32(acc) + tail;
+}
+
+// Channel group kernels: one gather per table fetches the entries of all eight channels
+
+DSDPCM_TARGET("avx2")
+static void accumulate_lanes_avx2(const ctable32_t* ctables, const uint8_t* data, int length, float* sums) {
+	__m256 acc = _mm256_setzero_ps();
+	for (auto j = 0; j < length; j++) {
+		__m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(data + j * 8)));
+		acc = _mm256_add_ps(acc, _mm256_i32gather_ps(ctables[j], index, sizeof(float)));
+	}
+	_mm256_storeu_ps(sums, acc);
+}
+
+DSDPCM_TARGET("avx2")
+static void accumulate_lanes_avx2(const ctable64_t* ctables, const uint8_t* data, int length, double* sums) {
+	__m256d acc0 = _mm256_setzero_pd();
+	__m256d acc1 = _mm256_setzero_pd();
+	for (auto j = 0; j < length; j++) {
+		__m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data + j * 8));
+		__m128i index0 = _mm_cvtepu8_epi32(bytes);
+		__m128i index1 = _mm_cvtepu8_epi32(_mm_srli_si128(bytes, 4));
+		acc0 = _mm256_add_pd(acc0, _mm256_i32gather_pd(ctables[j], index0, sizeof(double)));
+		acc1 = _mm256_add_pd(acc1, _mm256_i32gather_pd(ctables[j], index1, sizeof(double)));
+	}
+	_mm256_storeu_pd(sums + 0, acc0);
+	_mm256_storeu_pd(sums + 4, acc1);
+}
+
+DSDPCM_TARGET("avx2")
+static void accumulate_lanes_avx2(const ctablei32_t* ctables, const uint8_t* data, int length, int32_t* sums) {
+	__m256i acc = _mm256_setzero_si256();
+	for (auto j = 0; j < length; j++) {
+		__m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(data + j * 8)));
+		acc = _mm256_add_epi32(acc, _mm256_i32gather_epi32(reinterpret_cast<const int*>(ctables[j]), index, sizeof(int32_t)));
+	}
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(sums), acc);
+}
+
+// Two tables per gather, the upper eight lanes sum the odd tables and are folded in at the end
+DSDPCM_TARGET("avx512f")
+static void accumulate_lanes_avx512(const ctable32_t* ctables, const uint8_t* data, int length, float* sums) {
+	const __m512i offsets = _mm512_setr_epi32(0, 0, 0, 0, 0, 0, 0, 0, 256, 256, 256, 256, 256, 256, 256, 256);
+	__m512 acc = _mm512_setzero_ps();
+	auto j = 0;
+	for (; j + 2 <= length; j += 2) {
+		__m512i index = _mm512_add_epi32(_mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + j * 8))), offsets);
+		acc = _mm512_add_ps(acc, _mm512_i32gather_ps(index, ctables[j], sizeof(float)));
+	}
+	__m256 sum = _mm256_add_ps(_mm512_castps512_ps256(acc), _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(acc), 1)));
+	if (j < length) {
+		__m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(data + j * 8)));
+		sum = _mm256_add_ps(sum, _mm256_i32gather_ps(ctables[j], index, sizeof(float)));
+	}
+	_mm256_storeu_ps(sums, sum);
+}
+
+DSDPCM_TARGET("avx512f")
+static void accumulate_lanes_avx512(const ctablei32_t* ctables, const uint8_t* data, int length, int32_t* sums) {
+	const __m512i offsets = _mm512_setr_epi32(0, 0, 0, 0, 0, 0, 0, 0, 256, 256, 256, 256, 256, 256, 256, 256);
+	__m512i acc = _mm512_setzero_si512();
+	auto j = 0;
+	for (; j + 2 <= length; j += 2) {
+		__m512i index = _mm512_add_epi32(_mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + j * 8))), offsets);
+		acc = _mm512_add_epi32(acc, _mm512_i32gather_epi32(index, ctables[j], sizeof(int32_t)));
+	}
+	__m256i sum = _mm256_add_epi32(_mm512_castsi512_si256(acc), _mm512_extracti64x4_epi64(acc, 1));
+	if (j < length) {
+		__m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(data + j * 8)));
+		sum = _mm256_add_epi32(sum, _mm256_i32gather_epi32(reinterpret_cast<const int*>(ctables[j]), index, sizeof(int32_t)));
+	}
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(sums), sum);
+}
+
+DSDPCM_TARGET("avx512f")
+static void accumulate_lanes_avx512(const ctable64_t* ctables, const uint8_t* data, int length, double* sums) {
+	__m512d acc = _mm512_setzero_pd();
+	for (auto j = 0; j < length; j++) {
+		__m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(data + j * 8)));
+		acc = _mm512_add_pd(acc, _mm512_i32gather_pd(index, ctables[j], sizeof(double)));
+	}
+	_mm512_storeu_pd(sums, acc);
+}
+
+#endif
+
+#ifdef DSDPCM_NEON
+
+// NEON has no gather, the lanes are loaded one by one and summed in independent accumulators
+static float accumulate_neon(const ctable32_t* ctables, const uint8_t* data, int length) {
+	float32x4_t acc0 = vdupq_n_f32(0.0f);
+	float32x4_t acc1 = vdupq_n_f32(0.0f);
+	auto j = 0;
+	for (; j + 8 <= length; j += 8) {
+		float32x4_t v0 = vdupq_n_f32(0.0f);
+		float32x4_t v1 = vdupq_n_f32(0.0f);
+		v0 = vld1q_lane_f32(&ctables[j + 0][data[j + 0]], v0, 0);
+		v0 = vld1q_lane_f32(&ctables[j + 1][data[j + 1]], v0, 1);
+		v0 = vld1q_lane_f32(&ctables[j + 2][data[j + 2]], v0, 2);
+		v0 = vld1q_lane_f32(&ctables[j + 3][data[j + 3]], v0, 3);
+		v1 = vld1q_lane_f32(&ctables[j + 4][data[j + 4]], v1, 0);
+		v1 = vld1q_lane_f32(&ctables[j + 5][data[j + 5]], v1, 1);
+		v1 = vld1q_lane_f32(&ctables[j + 6][data[j + 6]], v1, 2);
+		v1 = vld1q_lane_f32(&ctables[j + 7][data[j + 7]], v1, 3);
+		acc0 = vaddq_f32(acc0, v0);
+		acc1 = vaddq_f32(acc1, v1);
+	}
+	acc0 = vaddq_f32(acc0, acc1);
+	float32x2_t sum = vadd_f32(vget_low_f32(acc0), vget_high_f32(acc0));
+	sum = vpadd_f32(sum, sum);
+	auto result = vget_lane_f32(sum, 0);
+	for (; j < length; j++) {
+		result += ctables[j][data[j]];
+	}
+	return result;
+}
+
+static int32_t accumulate_neon(const ctablei32_t* ctables, const uint8_t* data, int length) {
+	int32x4_t acc0 = vdupq_n_s32(0);
+	int32x4_t acc1 = vdupq_n_s32(0);
+	auto j = 0;
+	for (; j + 8 <= length; j += 8) {
+		int32x4_t v0 = vdupq_n_s32(0);
+		int32x4_t v1 = vdupq_n_s32(0);
+		v0 = vld1q_lane_s32(&ctables[j + 0][data[j + 0]], v0, 0);
+		v0 = vld1q_lane_s32(&ctables[j + 1][data[j + 1]], v0, 1);
+		v0 = vld1q_lane_s32(&ctables[j + 2][data[j + 2]], v0, 2);
+		v0 = vld1q_lane_s32(&ctables[j + 3][data[j + 3]], v0, 3);
+		v1 = vld1q_lane_s32(&ctables[j + 4][data[j + 4]], v1, 0);
+		v1 = vld1q_lane_s32(&ctables[j + 5][data[j + 5]], v1, 1);
+		v1 = vld1q_lane_s32(&ctables[j + 6][data[j + 6]], v1, 2);
+		v1 = vld1q_lane_s32(&ctables[j + 7][data[j + 7]], v1, 3);
+		acc0 = vaddq_s32(acc0, v0);
+		acc1 = vaddq_s32(acc1, v1);
+	}
+	acc0 = vaddq_s32(acc0, acc1);
+	int32x2_t sum = vadd_s32(vget_low_s32(acc0), vget_high_s32(acc0));
+	sum = vpadd_s32(sum, sum);
+	auto result = vget_lane_s32(sum, 0);
+	for (; j < length; j++) {
+		result += ctables[j][data[j]];
+	}
+	return result;
+}
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+static double accumulate_neon(const ctable64_t* ctables, const uint8_t* data, int length) {
+	float64x2_t acc0 = vdupq_n_f64(0.0);
+	float64x2_t acc1 = vdupq_n_f64(0.0);
+	auto j = 0;
+	for (; j + 4 <= length; j += 4) {
+		float64x2_t v0 = vdupq_n_f64(0.0);
+		float64x2_t v1 = vdupq_n_f64(0.0);
+		v0 = vld1q_lane_f64(&ctables[j + 0][data[j + 0]], v0, 0);
+		v0 = vld1q_lane_f64(&ctables[j + 1][data[j + 1]], v0, 1);
+		v1 = vld1q_lane_f64(&ctables[j + 2][data[j + 2]], v1, 0);
+		v1 = vld1q_lane_f64(&ctables[j + 3][data[j + 3]], v1, 1);
+		acc0 = vaddq_f64(acc0, v0);
+		acc1 = vaddq_f64(acc1, v1);
+	}
+	acc0 = vaddq_f64(acc0, acc1);
+	auto result = vgetq_lane_f64(acc0, 0) + vgetq_lane_f64(acc0, 1);
+	for (; j < length; j++) {
+		result += ctables[j][data[j]];
+	}
+	return result;
+}
+#endif
+
+static void accumulate_lanes_neon(const ctable32_t* ctables, const uint8_t* data, int length, float* sums) {
+	float32x4_t acc0 = vdupq_n_f32(0.0f);
+	float32x4_t acc1 = vdupq_n_f32(0.0f);
+	for (auto j = 0; j < length; j++) {
+		auto table = ctables[j];
+		auto bytes = data + j * 8;
+		float32x4_t v0 = vdupq_n_f32(0.0f);
+		float32x4_t v1 = vdupq_n_f32(0.0f);
+		v0 = vld1q_lane_f32(&table[bytes[0]], v0, 0);
+		v0 = vld1q_lane_f32(&table[bytes[1]], v0, 1);
+		v0 = vld1q_lane_f32(&table[bytes[2]], v0, 2);
+		v0 = vld1q_lane_f32(&table[bytes[3]], v0, 3);
+		v1 = vld1q_lane_f32(&table[bytes[4]], v1, 0);
+		v1 = vld1q_lane_f32(&table[bytes[5]], v1, 1);
+		v1 = vld1q_lane_f32(&table[bytes[6]], v1, 2);
+		v1 = vld1q_lane_f32(&table[bytes[7]], v1, 3);
+		acc0 = vaddq_f32(acc0, v0);
+		acc1 = vaddq_f32(acc1, v1);
+	}
+	vst1q_f32(sums + 0, acc0);
+	vst1q_f32(sums + 4, acc1);
+}
+
+static void accumulate_lanes_neon(const ctablei32_t* ctables, const uint8_t* data, int length, int32_t* sums) {
+	int32x4_t acc0 = vdupq_n_s32(0);
+	int32x4_t acc1 = vdupq_n_s32(0);
+	for (auto j = 0; j < length; j++) {
+		auto table = ctables[j];
+		auto bytes = data + j * 8;
+		int32x4_t v0 = vdupq_n_s32(0);
+		int32x4_t v1 = vdupq_n_s32(0);
+		v0 = vld1q_lane_s32(&table[bytes[0]], v0, 0);
+		v0 = vld1q_lane_s32(&table[bytes[1]], v0, 1);
+		v0 = vld1q_lane_s32(&table[bytes[2]], v0, 2);
+		v0 = vld1q_lane_s32(&table[bytes[3]], v0, 3);
+		v1 = vld1q_lane_s32(&table[bytes[4]], v1, 0);
+		v1 = vld1q_lane_s32(&table[bytes[5]], v1, 1);
+		v1 = vld1q_lane_s32(&table[bytes[6]], v1, 2);
+		v1 = vld1q_lane_s32(&table[bytes[7]], v1, 3);
+		acc0 = vaddq_s32(acc0, v0);
+		acc1 = vaddq_s32(acc1, v1);
+	}
+	vst1q_s32(sums + 0, acc0);
+	vst1q_s32(sums + 4, acc1);
+}
+
+#endif
+
+template<>
+DSDPCMFirKernel<float>::accumulate_t DSDPCMFirKernel<float>::get_accumulate(int length) {
+	static const accumulate_t accumulate_fn = []() -> accumulate_t {
+#if defined(DSDPCM_X86)
+		if (cpu_has_avx512()) {
+			return accumulate_avx512;
+		}
+		if (cpu_has_avx2()) {
+			return accumulate_avx2;
+		}
+#elif defined(DSDPCM_NEON)
+		return accumulate_neon;
+#endif
+		return accumulate;
+	}();
+	return (length < SIMD_MIN_LENGTH) ? accumulate : accumulate_fn;
+}
+
+template<>
+DSDPCMFirKernel<double>::accumulate_t DSDPCMFirKernel<double>::get_accumulate(int length) {
+	static const accumulate_t accumulate_fn = []() -> accumulate_t {
+#if defined(DSDPCM_X86)
+		if (cpu_has_avx512()) {
+			return accumulate_avx512;
+		}
+		if (cpu_has_avx2()) {
+			return accumulate_avx2;
+		}
+#elif defined(DSDPCM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+		return accumulate_neon;
+#endif
+		return accumulate;
+	}();
+	return (length < SIMD_MIN_LENGTH) ? accumulate : accumulate_fn;
+}
+
+template<>
+DSDPCMFirKernel<int32_t>::accumulate_t DSDPCMFirKernel<int32_t>::get_accumulate(int length) {
+	static const accumulate_t accumulate_fn = []() -> accumulate_t {
+#if defined(DSDPCM_X86)
+		if (cpu_has_avx512()) {
+			return accumulate_avx512;
+		}
+		if (cpu_has_avx2()) {
+			return accumulate_avx2;
+		}
+#elif defined(DSDPCM_NEON)
+		return accumulate_neon;
+#endif
+		return accumulate;
+	}();
+	return (length < SIMD_MIN_LENGTH) ? accumulate : accumulate_fn;
+}
+
+template<>
+DSDPCMFirKernel<float>::accumulate_lanes_t DSDPCMFirKernel<float>::get_accumulate_lanes() {
+	static const accumulate_lanes_t accumulate_fn = []() -> accumulate_lanes_t {
+#if defined(DSDPCM_X86)
+		if (cpu_has_avx512()) {
+			return accumulate_lanes_avx512;
+		}
+		if (cpu_has_avx2()) {
+			return accumulate_lanes_avx2;
+		}
+#elif defined(DSDPCM_NEON)
+		return accumulate_lanes_neon;
+#endif
+		return accumulate_lanes;
+	}();
+	return accumulate_fn;
+}
+
+template<>
+DSDPCMFirKernel<double>::accumulate_lanes_t DSDPCMFirKernel<double>::get_accumulate_lanes() {
+	static const accumulate_lanes_t accumulate_fn = []() -> accumulate_lanes_t {
+#if defined(DSDPCM_X86)
+		if (cpu_has_avx512()) {
+			return accumulate_lanes_avx512;
+		}
+		if (cpu_has_avx2()) {
+			return accumulate_lanes_avx2;
+		}
+#endif
+		return accumulate_lanes;
+	}();
+	return accumulate_fn;
+}
+
+template<>
+DSDPCMFirKernel<int32_t>::accumulate_lanes_t DSDPCMFirKernel<int32_t>::get_accumulate_lanes() {
+	static const accumulate_lanes_t accumulate_fn = []() -> accumulate_lanes_t {
+#if defined(DSDPCM_X86)
+		if (cpu_has_avx512()) {
+			return accumulate_lanes_avx512;
+		}
+		if (cpu_has_avx2()) {
+			return accumulate_lanes_avx2;
+		}
+#elif defined(DSDPCM_NEON)
+		return accumulate_lanes_neon;
+#endif
+		return accumulate_lanes;
+	}();
+	return accumulate_fn;
+}
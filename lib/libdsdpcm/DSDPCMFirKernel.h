@@ -0,0 +1,70 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2021 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+/*
+* Lookup-table accumulation used by DSDPCMFir: sums ctables[j][data[j]] over all tables.
+* get_accumulate() picks the widest kernel supported by the running CPU (AVX-512 or AVX2
+* gathers on x86, lane loads on NEON) and falls back to the scalar loop otherwise.
+* Gathers do not pay off for short filters, these keep the scalar loop.
+* The SIMD kernels add the tables in another order than the scalar loop. int32 sums come out the same, fp64 sums
+* only as long as every partial sum is exact, which holds for the built-in linear phase tables (integer taps scaled
+* by a power of two). Minimum phase and user filter tables differ at rounding level in fp64 (about 300 dB below
+* the peak) and all tables do in fp32 (about 127 dB below the peak).
+* get_accumulate_lanes() returns the channel group variant: the data holds LANES bytes per table, one per channel,
+* and every lane is summed in table order, so each lane matches the scalar loop on its own channel.
+*/
+template<typename real_t>
+class DSDPCMFirKernel {
+	using ctable_t = real_t[256];
+public:
+	using accumulate_t = real_t(*)(const ctable_t* ctables, const uint8_t* data, int length);
+	using accumulate_lanes_t = void(*)(const ctable_t* ctables, const uint8_t* data, int length, real_t* sums);
+	static constexpr int SIMD_MIN_LENGTH = 32;
+	static constexpr int LANES = 8;
+	static accumulate_t get_accumulate(int length);
+	static accumulate_lanes_t get_accumulate_lanes();
+	static real_t accumulate(const ctable_t* ctables, const uint8_t* data, int length) {
+		real_t sum = (real_t)0;
+		for (auto j = 0; j < length; j++) {
+			sum += ctables[j][data[j]];
+		}
+		return sum;
+	}
+	static void accumulate_lanes(const ctable_t* ctables, const uint8_t* data, int length, real_t* sums) {
+		for (auto lane = 0; lane < LANES; lane++) {
+			sums[lane] = (real_t)0;
+		}
+		for (auto j = 0; j < length; j++) {
+			for (auto lane = 0; lane < LANES; lane++) {
+				sums[lane] += ctables[j][data[j * LANES + lane]];
+			}
+		}
+	}
+};
+
+template<> DSDPCMFirKernel<float>::accumulate_t DSDPCMFirKernel<float>::get_accumulate(int length);
+template<> DSDPCMFirKernel<double>::accumulate_t DSDPCMFirKernel<double>::get_accumulate(int length);
+template<> DSDPCMFirKernel<int32_t>::accumulate_t DSDPCMFirKernel<int32_t>::get_accumulate(int length);
+template<> DSDPCMFirKernel<float>::accumulate_lanes_t DSDPCMFirKernel<float>::get_accumulate_lanes();
+template<> DSDPCMFirKernel<double>::accumulate_lanes_t DSDPCMFirKernel<double>::get_accumulate_lanes();
+template<> DSDPCMFirKernel<int32_t>::accumulate_lanes_t DSDPCMFirKernel<int32_t>::get_accumulate_lanes();
@@ -25,8 +25,9 @@
 template<typename real_t>
 class DSDPCMFir {
 	using ctable_t = real_t[256];
-	ctable_t* fir_ctables;
+	const ctable_t* fir_ctables;
 	int       fir_order;
+	float     fir_delay;
 	int       fir_length;
 	int       decimation;
 
@@ -40,6 +41,7 @@ public:
 		}
 		fir_ctables = nullptr;
 		fir_order = 0;
+		fir_delay = 0.0f;
 		fir_length = 0;
 		decimation = 0;
 		fir_dly = nullptr;
@@ -51,11 +53,12 @@ public:
 		return decimation;
 	}
 	float get_delay() {
-		return (float)fir_order / 2 / 8 / decimation;
+		return fir_delay / 8 / decimation;
 	}
-	void init(ctable_t* p_fir_ctables, int p_fir_length, int p_decimation) {
+	void init(const ctable_t* p_fir_ctables, int p_fir_length, int p_decimation, float p_fir_delay) {
 		fir_ctables = p_fir_ctables;
 		fir_order = p_fir_length - 1;
+		fir_delay = p_fir_delay;
 		fir_length = CTABLES(p_fir_length);
 		decimation = p_decimation / 8;
 		fir_dly = ippsMalloc_8u(fir_length);
@@ -72,7 +75,10 @@ public:
 			fir_out = nullptr;
 		}
 	}
-	int run(uint8_t* p_dsd_data, real_t* p_pcm_data, int p_dsd_samples) {
+	void reset() {
+		memset(fir_dly, DSD_SILENCE_BYTE, fir_length);
+	}
+	int run(uint8_t* p_dsd_data, real_t* p_pcm_data, int p_dsd_samples, int p_dsd_stride = 1) {
 		auto pcm_samples = p_dsd_samples / decimation;
 		auto fir_index = 0;
 		for (auto sample = 0; sample < pcm_samples; sample++) {
@@ -80,12 +86,19 @@ public:
 				fir_out[j] = fir_ctables[j][fir_dly[fir_index + j]];
 			}
 			for (auto j = (fir_length > fir_index) ? fir_length - fir_index : 0; j < fir_length; j++) {
-				fir_out[j] = fir_ctables[j][p_dsd_data[j - (fir_length - fir_index)]];
+				fir_out[j] = fir_ctables[j][p_dsd_data[(j - (fir_length - fir_index)) * p_dsd_stride]];
 			}
 			fir_index += decimation;
 			Fir_IPP::Sum(fir_out, fir_length, &p_pcm_data[sample]);
 		}
-		ippsCopy_8u(&p_dsd_data[p_dsd_samples - fir_length], fir_dly, fir_length);
+		if (p_dsd_stride == 1) {
+			ippsCopy_8u(&p_dsd_data[p_dsd_samples - fir_length], fir_dly, fir_length);
+		}
+		else {
+			for (auto j = 0; j < fir_length; j++) {
+				fir_dly[j] = p_dsd_data[(p_dsd_samples - fir_length + j) * p_dsd_stride];
+			}
+		}
 		return pcm_samples;
 	}
 };
@@ -0,0 +1,117 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2021 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+
+#pragma once
+
+#include <complex>
+#include <math.h>
+#include <vector>
+
+using std::complex;
+using std::vector;
+
+/*
+* Minimum phase counterpart of a linear phase FIR filter with the same length and magnitude response.
+* The homomorphic (cepstral) method folds the real cepstrum of log|H| onto its causal half, so all zeros end up
+* inside the unit circle. The FFT is 16 times longer than the filter to keep cepstral aliasing below the stopband.
+*/
+class DSDPCMMinPhase {
+	static constexpr int FFT_OVERSAMPLING = 16;
+	static constexpr double MAGNITUDE_FLOOR = 1e-12;
+public:
+	static void make_min_phase(const double* fir_coefs, int fir_length, double* out_coefs) {
+		auto fft_length = 1;
+		while (fft_length < FFT_OVERSAMPLING * fir_length) {
+			fft_length *= 2;
+		}
+		vector<complex<double>> spectrum(fft_length);
+		for (auto i = 0; i < fir_length; i++) {
+			spectrum[i] = fir_coefs[i];
+		}
+		fft(spectrum, false);
+		auto magnitude_max = 0.0;
+		for (auto& bin : spectrum) {
+			magnitude_max = fmax(magnitude_max, abs(bin));
+		}
+		for (auto& bin : spectrum) {
+			bin = log(fmax(abs(bin), magnitude_max * MAGNITUDE_FLOOR));
+		}
+		fft(spectrum, true);
+		for (auto i = 1; i < fft_length / 2; i++) {
+			spectrum[i] *= 2.0;
+		}
+		for (auto i = fft_length / 2 + 1; i < fft_length; i++) {
+			spectrum[i] = 0.0;
+		}
+		spectrum[0] = spectrum[0].real();
+		spectrum[fft_length / 2] = spectrum[fft_length / 2].real();
+		fft(spectrum, false);
+		for (auto& bin : spectrum) {
+			bin = exp(bin);
+		}
+		fft(spectrum, true);
+		for (auto i = 0; i < fir_length; i++) {
+			out_coefs[i] = spectrum[i].real();
+		}
+	}
+	static float get_delay(const double* fir_coefs, int fir_length) {
+		// Group delay at DC, which is what the low frequency content of the signal is delayed by
+		auto moment = 0.0;
+		auto sum = 0.0;
+		for (auto i = 0; i < fir_length; i++) {
+			moment += i * fir_coefs[i];
+			sum += fir_coefs[i];
+		}
+		return (float)(moment / sum);
+	}
+private:
+	static void fft(vector<complex<double>>& data, bool inverse) {
+		auto n = (int)data.size();
+		for (auto i = 1, j = 0; i < n; i++) {
+			auto bit = n >> 1;
+			for (; j & bit; bit >>= 1) {
+				j ^= bit;
+			}
+			j ^= bit;
+			if (i < j) {
+				std::swap(data[i], data[j]);
+			}
+		}
+		for (auto length = 2; length <= n; length <<= 1) {
+			auto angle = 2 * M_PI / length * (inverse ? 1 : -1);
+			auto w_length = complex<double>(cos(angle), sin(angle));
+			for (auto i = 0; i < n; i += length) {
+				auto w = complex<double>(1.0);
+				for (auto j = 0; j < length / 2; j++) {
+					auto u = data[i + j];
+					auto v = data[i + j + length / 2] * w;
+					data[i + j] = u + v;
+					data[i + j + length / 2] = u - v;
+					w *= w_length;
+				}
+			}
+		}
+		if (inverse) {
+			for (auto& value : data) {
+				value /= (double)n;
+			}
+		}
+	}
+};
@@ -20,62 +20,70 @@
 #pragma once
 
 #include "DSDPCMConstants.h"
+#include "DSDPCMFirHistory.h"
 #include "DSDPCMUtil.h"
 
 template<typename real_t>
 class PCMPCMFir {
 	real_t* fir_coefs;
 	int     fir_order;
+	float   fir_delay;
 	int     fir_length;
 	int     decimation;
-	real_t* fir_buffer;
-	int     fir_index;
+	DSDPCMFirHistory<real_t> fir_history;
 public:
 	PCMPCMFir() {
 		fir_coefs = nullptr;
 		fir_order = 0;
+		fir_delay = 0.0f;
 		fir_length = 0;
 		decimation = 1;
-		fir_buffer = nullptr;
-		fir_index = 0;
 	}
 	~PCMPCMFir() {
 		free();
 	}
-	void init(real_t* p_fir_coefs, int p_fir_length, int p_decimation) {
+	void init(real_t* p_fir_coefs, int p_fir_length, int p_decimation, float p_fir_delay) {
 		fir_coefs = p_fir_coefs;
 		fir_order = p_fir_length - 1;
+		fir_delay = p_fir_delay;
 		fir_length = p_fir_length;
 		decimation = p_decimation;
-		auto buf_size = 2 * fir_length * sizeof(real_t);
-		fir_buffer = (real_t*)DSDPCMUtil::mem_alloc(buf_size);
-		memset(fir_buffer, 0, buf_size);
-		fir_index = 0;
+		fir_history.init(fir_length, (real_t)0);
 	}
 	void free() {
-		if (fir_buffer) {
-			DSDPCMUtil::mem_free(fir_buffer);
-			fir_buffer = nullptr;
-		}
+		fir_history.free();
+	}
+	void reset() {
+		fir_history.reset();
 	}
 	int get_decimation() {
 		return decimation;
 	}
 	float get_delay() {
-		return (float)fir_order / 2 / decimation;
+		return fir_delay / decimation;
 	}
 	int run(real_t* p_pcm_data, real_t* p_out_data, int p_pcm_samples) {
 		auto out_samples = p_pcm_samples / decimation;
-		for (auto sample = 0; sample < out_samples; sample++) {
-			for (auto i = 0; i < decimation; i++) {
-				fir_buffer[fir_index + fir_length] = fir_buffer[fir_index] = *(p_pcm_data++);
-				fir_index = (++fir_index) % fir_length;
-			}
-			p_out_data[sample] = (real_t)0;
-			for (auto j = 0; j < fir_length; j++) {
-				p_out_data[sample] += fir_coefs[j] * fir_buffer[fir_index + j];
-			}
+		auto pcm_samples = out_samples * decimation;
+		auto head_samples = fir_history.get_head_outputs(out_samples, decimation);
+		auto head_data = fir_history.stage(p_pcm_data, pcm_samples);
+		auto offset = decimation - fir_length;
+		for (auto sample = 0; sample < head_samples; sample++) {
+			p_out_data[sample] = convolve(head_data + sample * decimation + offset);
+		}
+		for (auto sample = head_samples; sample < out_samples; sample++) {
+			p_out_data[sample] = convolve(p_pcm_data + sample * decimation + offset);
 		}
+		fir_history.save(p_pcm_data, pcm_samples);
 		return out_samples;
 	}
+private:
+	real_t convolve(const real_t* fir_data) {
+		using acc_t = typename DSDPCMSample<real_t>::acc_t;
+		auto out = (acc_t)0;
+		for (auto j = 0; j < fir_length; j++) {
+			out += (acc_t)fir_coefs[j] * fir_data[j];
+		}
+		return DSDPCMSample<real_t>::from_acc(out);
+	}
 };
@@ -0,0 +1,145 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2021 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include "DSDPCMConstants.h"
+#include "DSDPCMFirHistory.h"
+#include "DSDPCMUtil.h"
+
+/*
+* Decimator by 2 for symmetric halfband filters.
+* Every other tap of a halfband filter is zero except the center one, so the input splits into two phases:
+* one phase runs through the folded symmetric taps, the other one only through the center tap.
+* Both phases are read in place from the input block with stride 2, they are not copied into phase buffers.
+* The folded sum adds the two samples of a tap pair before the multiply, so the output matches PCMPCMFir
+* at rounding level only, with fp64 too.
+* Coefficients without halfband structure are passed to PCMPCMFir.
+*/
+template<typename real_t>
+class PCMPCMFirHalfband {
+	real_t* fir_coefs;
+	int     fir_order;
+	float   fir_delay;
+	int     fir_length;
+	int     fir_pairs;
+	int     first_side;
+	real_t  center_coef;
+	bool    is_halfband;
+	DSDPCMFirHistory<real_t> fir_history;
+	PCMPCMFir<real_t> fir_generic;
+public:
+	PCMPCMFirHalfband() {
+		fir_coefs = nullptr;
+		fir_order = 0;
+		fir_delay = 0.0f;
+		fir_length = 0;
+		fir_pairs = 0;
+		first_side = 0;
+		center_coef = (real_t)0;
+		is_halfband = false;
+	}
+	~PCMPCMFirHalfband() {
+		free();
+	}
+	void init(real_t* p_fir_coefs, int p_fir_length, int p_decimation, float p_fir_delay) {
+		fir_order = p_fir_length - 1;
+		fir_delay = p_fir_delay;
+		fir_length = p_fir_length;
+		is_halfband = p_decimation == 2 && check_halfband(p_fir_coefs, p_fir_length);
+		if (!is_halfband) {
+			fir_generic.init(p_fir_coefs, p_fir_length, p_decimation, p_fir_delay);
+			return;
+		}
+		auto center = fir_order / 2;
+		first_side = (center + 1) % 2;
+		fir_pairs = (p_fir_length - first_side + 1) / 4;
+		center_coef = p_fir_coefs[center];
+		fir_coefs = (real_t*)DSDPCMUtil::mem_alloc(fir_pairs * sizeof(real_t));
+		for (auto i = 0; i < fir_pairs; i++) {
+			fir_coefs[i] = p_fir_coefs[first_side + 2 * i];
+		}
+		fir_history.init(fir_length, (real_t)0);
+	}
+	void free() {
+		if (fir_coefs) {
+			DSDPCMUtil::mem_free(fir_coefs);
+			fir_coefs = nullptr;
+		}
+		fir_history.free();
+		fir_generic.free();
+	}
+	void reset() {
+		if (!is_halfband) {
+			fir_generic.reset();
+			return;
+		}
+		fir_history.reset();
+	}
+	int get_decimation() {
+		return is_halfband ? 2 : fir_generic.get_decimation();
+	}
+	float get_delay() {
+		return is_halfband ? fir_delay / 2 : fir_generic.get_delay();
+	}
+	int run(real_t* p_pcm_data, real_t* p_out_data, int p_pcm_samples) {
+		if (!is_halfband) {
+			return fir_generic.run(p_pcm_data, p_out_data, p_pcm_samples);
+		}
+		auto out_samples = p_pcm_samples / 2;
+		auto pcm_samples = out_samples * 2;
+		auto head_samples = fir_history.get_head_outputs(out_samples, 2);
+		auto head_data = fir_history.stage(p_pcm_data, pcm_samples);
+		auto offset = 2 - fir_length;
+		for (auto sample = 0; sample < head_samples; sample++) {
+			p_out_data[sample] = convolve(head_data + 2 * sample + offset);
+		}
+		for (auto sample = head_samples; sample < out_samples; sample++) {
+			p_out_data[sample] = convolve(p_pcm_data + 2 * sample + offset);
+		}
+		fir_history.save(p_pcm_data, pcm_samples);
+		return out_samples;
+	}
+private:
+	real_t convolve(const real_t* fir_data) {
+		auto side_data = fir_data + first_side;
+		auto side_last = fir_order - 2 * first_side;
+		using acc_t = typename DSDPCMSample<real_t>::acc_t;
+		auto out = (acc_t)center_coef * fir_data[fir_order / 2];
+		for (auto i = 0; i < fir_pairs; i++) {
+			out += (acc_t)fir_coefs[i] * ((acc_t)side_data[2 * i] + side_data[side_last - 2 * i]);
+		}
+		return DSDPCMSample<real_t>::from_acc(out);
+	}
+	static bool check_halfband(const real_t* p_fir_coefs, int p_fir_length) {
+		if (p_fir_length % 2 == 0) {
+			return false;
+		}
+		auto center = (p_fir_length - 1) / 2;
+		for (auto j = 0; j < center; j++) {
+			if (p_fir_coefs[j] != p_fir_coefs[p_fir_length - 1 - j]) {
+				return false;
+			}
+			if ((center - j) % 2 == 0 && p_fir_coefs[j] != (real_t)0) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
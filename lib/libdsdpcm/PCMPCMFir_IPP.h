@@ -28,6 +28,7 @@ template<typename real_t>
 class PCMPCMFir {
 	real_t* fir_coefs;
 	int     fir_order;
+	float   fir_delay;
 	int     fir_length;
 	int     decimation;
 
@@ -42,6 +43,7 @@ public:
 		}
 		fir_coefs = nullptr;
 		fir_order = 0;
+		fir_delay = 0.0f;
 		fir_length = 0;
 		decimation = 0;
 
@@ -56,13 +58,14 @@ public:
 		return decimation;
 	}
 	float get_delay() {
-		return (float)fir_order / 2 / decimation;
+		return fir_delay / decimation;
 	}
-	void init(real_t* p_fir_coefs, int p_fir_length, int p_decimation) {
+	void init(real_t* p_fir_coefs, int p_fir_length, int p_decimation, float p_fir_delay) {
 		fir_coefs = p_fir_coefs;
 		fir_length = p_fir_length;
 		decimation = p_decimation;
 		fir_order = p_fir_length - 1;
+		fir_delay = p_fir_delay;
 		fir_dly = (sizeof(real_t) == sizeof(float)) ? reinterpret_cast<real_t*>(ippsMalloc_32f(p_fir_length)) : reinterpret_cast<real_t*>(ippsMalloc_64f(p_fir_length));
 		int specSize = 0;
 		int bufSize = 0;
@@ -85,6 +88,9 @@ public:
 			fir_dly = nullptr;
 		}
 	}
+	void reset() {
+		memset(fir_dly, 0, fir_length * sizeof(real_t));
+	}
 	int run(real_t* m_pcm_data, real_t* out_data, int pcm_samples) {
 		int out_samples = pcm_samples / decimation;
 		Fir_IPP::FIRMR(m_pcm_data, out_data, out_samples, fir_spec, fir_dly, fir_dly, fir_buf);
@@ -0,0 +1,130 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2021 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+
+#pragma once
+
+#include "DSDPCMConstants.h"
+#include "DSDPCMFilterCache.h"
+#include "DSDPCMFirHistory.h"
+#include "DSDPCMUtil.h"
+
+#include <math.h>
+
+/*
+* Rational polyphase resampler, converts the rate by interpolation / decimation (160 / 147 turns 44.1 kHz into 48 kHz).
+* The prototype lowpass is a Kaiser windowed sinc of phase_length * interpolation taps, cut off just below the
+* input Nyquist frequency, and is stored per phase. Every output convolves phase_length input samples with one phase.
+*/
+template<typename real_t>
+class PCMPCMResampler {
+	using filter_cache_t = DSDPCMFilterCache<real_t>;
+	static constexpr double PASSBAND = 0.9535;
+	static constexpr double KAISER_BETA = 9.0;
+	shared_ptr<real_t> fir_coefs;
+	int interpolation;
+	int decimation;
+	int phase_length;
+	int phase_time;
+	DSDPCMFirHistory<real_t> fir_history;
+public:
+	PCMPCMResampler() {
+		interpolation = 1;
+		decimation = 1;
+		phase_length = 0;
+		phase_time = 0;
+	}
+	~PCMPCMResampler() {
+		free();
+	}
+	void init(int p_interpolation, int p_decimation, int p_phase_length) {
+		interpolation = p_interpolation;
+		decimation = p_decimation;
+		phase_length = p_phase_length;
+		phase_time = 0;
+		auto ratio_hash = ((uint64_t)interpolation << 32) | ((uint64_t)decimation << 16) | (uint64_t)phase_length;
+		fir_coefs = filter_cache_t::get_instance().get_table(filter_cache_t::PCMRESAMPLER, 0, ratio_hash, interpolation * phase_length, [&](real_t* table) {
+			set_coefs(table);
+		});
+		fir_history.init(phase_length, (real_t)0);
+	}
+	void free() {
+		fir_history.free();
+		fir_coefs.reset();
+	}
+	void reset() {
+		fir_history.reset();
+		phase_time = 0;
+	}
+	float get_delay() {
+		return (float)(phase_length * interpolation - 1) / 2 / decimation;
+	}
+	int get_out_samples(int pcm_samples) {
+		return (int)(((int64_t)pcm_samples * interpolation + decimation - 1) / decimation) + 1;
+	}
+	int run(const real_t* p_pcm_data, real_t* p_out_data, int p_pcm_samples) {
+		auto tail_length = phase_length - 1;
+		auto head_data = fir_history.stage(p_pcm_data, p_pcm_samples);
+		auto end_time = p_pcm_samples * interpolation;
+		auto out_samples = 0;
+		for (; phase_time < end_time; phase_time += decimation) {
+			auto sample = phase_time / interpolation;
+			auto phase = phase_time - sample * interpolation;
+			auto fir_data = ((sample < tail_length) ? head_data : p_pcm_data) + sample - tail_length;
+			p_out_data[out_samples++] = convolve(fir_coefs.get() + phase * phase_length, fir_data);
+		}
+		phase_time -= end_time;
+		fir_history.save(p_pcm_data, p_pcm_samples);
+		return out_samples;
+	}
+private:
+	real_t convolve(const real_t* coefs, const real_t* fir_data) {
+		auto out = (real_t)0;
+		for (auto j = 0; j < phase_length; j++) {
+			out += coefs[j] * fir_data[j];
+		}
+		return out;
+	}
+	static double bessel_i0(double x) {
+		auto sum = 1.0;
+		auto term = 1.0;
+		for (auto k = 1; k < 64 && term > 1e-21 * sum; k++) {
+			term *= (x / (2 * k)) * (x / (2 * k));
+			sum += term;
+		}
+		return sum;
+	}
+	void set_coefs(real_t* out_coefs) {
+		auto fir_length = phase_length * interpolation;
+		auto center = (double)(fir_length - 1) / 2;
+		auto cutoff = PASSBAND / (2 * interpolation);
+		auto window_norm = 1.0 / bessel_i0(KAISER_BETA);
+		for (auto i = 0; i < fir_length; i++) {
+			auto t = (double)i - center;
+			auto r = 2 * t / (fir_length - 1);
+			auto window = bessel_i0(KAISER_BETA * sqrt(fmax(0.0, 1 - r * r))) * window_norm;
+			auto x = 2 * M_PI * cutoff * t;
+			auto sinc = (x == 0.0) ? 1.0 : sin(x) / x;
+			// Phase p, tap j holds prototype tap p + (phase_length - 1 - j) * interpolation, the gain of interpolation keeps unity level
+			auto phase = i % interpolation;
+			auto tap = phase_length - 1 - i / interpolation;
+			out_coefs[phase * phase_length + tap] = (real_t)(interpolation * 2 * cutoff * sinc * window);
+		}
+	}
+};
@@ -0,0 +1,452 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2021 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "DSDPCMConverterDirect.h"
+#include "DSDPCMConverterEngine.h"
+#include "DSDPCMConverterMultistage.h"
+#include <chrono>
+#include <math.h>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using bench_clock_t = std::chrono::steady_clock;
+
+/*
+* Throughput benchmark for DSDPCMConverterEngine, built outside Kodi.
+* Every combination of the requested DSD rates, PCM rates, converter types, precisions and channel counts
+* converts the same DSD signal: a sigma-delta modulated sine per channel or a raw file of channel interleaved DSD bytes.
+* Times are given in ns per output PCM sample and channel. Besides the whole engine the time is split into stages,
+* measured on per channel converters run one after another:
+*   dsd_fir - the lookup table filter reading DSD,
+*   pcm_fir - the PCM decimation filters that follow it,
+*   output  - whatever is left in the engine: interleaving, gain, format conversion, 48 kHz family resampling.
+*/
+
+constexpr int BENCH_FRAMERATE = 75;
+constexpr int BENCH_DSD64_RATE = 2822400;
+
+struct bench_options_t {
+	vector<int> dsd_rates{ 64, 128, 256 };
+	vector<int> pcm_rates{ 44100, 88200, 176400, 352800 };
+	vector<conv_type_e> types{ conv_type_e::MULTISTAGE, conv_type_e::DIRECT };
+	vector<conv_precision_e> precisions{ conv_precision_e::FP32, conv_precision_e::FP64, conv_precision_e::INT32 };
+	vector<int> channels{ 2, 6 };
+	double seconds = 2.0;
+	string input;
+	bool json = false;
+	bool frame_parallel = false;
+	bool channel_group = false;
+	bool min_phase = false;
+};
+
+struct bench_result_t {
+	int    dsd_rate;
+	int    pcm_rate;
+	int    decimation;
+	conv_type_e type;
+	conv_precision_e precision;
+	int    channels;
+	double seconds;
+	double ns_per_sample;
+	double rt_factor;
+	double dsd_fir_ns;
+	double pcm_fir_ns;
+	double output_ns;
+};
+
+static double elapsed(bench_clock_t::time_point start) {
+	return std::chrono::duration<double>(bench_clock_t::now() - start).count();
+}
+
+static const char* type_name(conv_type_e type) {
+	return (type == conv_type_e::MULTISTAGE) ? "multistage" : "direct";
+}
+
+static const char* precision_name(conv_precision_e precision) {
+	return (precision == conv_precision_e::FP64) ? "fp64" : (precision == conv_precision_e::INT32) ? "int32" : "fp32";
+}
+
+/*
+* Runs the DSD FIR of one converter alone and a second converter of the same type whole,
+* the PCM FIR time is the difference of the two.
+*/
+class StageTimer {
+public:
+	virtual ~StageTimer() {
+	}
+	virtual void run(uint8_t* dsd_data, int dsd_samples, int dsd_stride, double& dsd_fir_time, double& conv_time) = 0;
+};
+
+template<typename real_t, typename conv_t>
+class StageTimerT : public StageTimer {
+	conv_t  conv_fir1;
+	conv_t  conv_all;
+	real_t* pcm_data;
+public:
+	StageTimerT(DSDPCMFilterSetup<real_t>& flt_setup, int dsd_samples) {
+		conv_fir1.init(flt_setup, dsd_samples);
+		conv_all.init(flt_setup, dsd_samples);
+		pcm_data = (real_t*)DSDPCMUtil::mem_alloc(dsd_samples * sizeof(real_t));
+	}
+	~StageTimerT() {
+		DSDPCMUtil::mem_free(pcm_data);
+	}
+	void run(uint8_t* dsd_data, int dsd_samples, int dsd_stride, double& dsd_fir_time, double& conv_time) override {
+		auto start = bench_clock_t::now();
+		conv_fir1.get_fir1().run(dsd_data, pcm_data, dsd_samples, dsd_stride);
+		dsd_fir_time += elapsed(start);
+		start = bench_clock_t::now();
+		conv_all.convert(dsd_data, pcm_data, dsd_samples, dsd_stride);
+		conv_time += elapsed(start);
+	}
+};
+
+template<typename real_t, template<typename, int, typename> class conv_t>
+static StageTimer* new_stage_timer(DSDPCMFilterSetup<real_t>& flt_setup, int decimation, int dsd_samples) {
+	switch (decimation) {
+	case 1024:
+		return new StageTimerT<real_t, conv_t<real_t, 1024, DSDPCMFir<real_t>>>(flt_setup, dsd_samples);
+	case 512:
+		return new StageTimerT<real_t, conv_t<real_t, 512, DSDPCMFir<real_t>>>(flt_setup, dsd_samples);
+	case 256:
+		return new StageTimerT<real_t, conv_t<real_t, 256, DSDPCMFir<real_t>>>(flt_setup, dsd_samples);
+	case 128:
+		return new StageTimerT<real_t, conv_t<real_t, 128, DSDPCMFir<real_t>>>(flt_setup, dsd_samples);
+	case 64:
+		return new StageTimerT<real_t, conv_t<real_t, 64, DSDPCMFir<real_t>>>(flt_setup, dsd_samples);
+	case 32:
+		return new StageTimerT<real_t, conv_t<real_t, 32, DSDPCMFir<real_t>>>(flt_setup, dsd_samples);
+	case 16:
+		return new StageTimerT<real_t, conv_t<real_t, 16, DSDPCMFir<real_t>>>(flt_setup, dsd_samples);
+	case 8:
+		return new StageTimerT<real_t, conv_t<real_t, 8, DSDPCMFir<real_t>>>(flt_setup, dsd_samples);
+	}
+	return nullptr;
+}
+
+template<typename real_t>
+static void run_stages(const bench_options_t& options, conv_type_e type, int decimation, int channels, const vector<uint8_t>& dsd_stream, int frame_bytes, int frames, double& dsd_fir_time, double& conv_time) {
+	DSDPCMFilterSetup<real_t> flt_setup;
+	flt_setup.set_phase(options.min_phase ? filter_phase_e::MINIMUM : filter_phase_e::LINEAR);
+	auto dsd_samples = frame_bytes / channels;
+	vector<unique_ptr<StageTimer>> timers;
+	for (auto ch = 0; ch < channels; ch++) {
+		if (type == conv_type_e::MULTISTAGE) {
+			timers.emplace_back(new_stage_timer<real_t, DSDPCMConverterMultistage>(flt_setup, decimation, dsd_samples));
+		}
+		else {
+			timers.emplace_back(new_stage_timer<real_t, DSDPCMConverterDirect>(flt_setup, decimation, dsd_samples));
+		}
+	}
+	auto stream_frames = (int)(dsd_stream.size() / frame_bytes);
+	auto dsd_data = const_cast<uint8_t*>(dsd_stream.data());
+	for (auto frame = 0; frame <= frames; frame++) {
+		// The first frame only fills the filter history, like the engine lead-in
+		double dsd_fir_frame = 0.0;
+		double conv_frame = 0.0;
+		auto frame_data = dsd_data + (size_t)(frame % stream_frames) * frame_bytes;
+		for (auto ch = 0; ch < channels; ch++) {
+			timers[ch]->run(frame_data + ch, dsd_samples, channels, dsd_fir_frame, conv_frame);
+		}
+		if (frame > 0) {
+			dsd_fir_time += dsd_fir_frame;
+			conv_time += conv_frame;
+		}
+	}
+}
+
+/*
+* Second order sigma-delta modulator, a half scale sine a few hundred Hz apart on every channel.
+* One second of signal is generated and played in a loop.
+*/
+static vector<uint8_t> make_dsd_stream(int dsd_rate, int channels) {
+	auto dsd_samples = dsd_rate / 8;
+	vector<uint8_t> dsd_stream((size_t)dsd_samples * channels);
+	for (auto ch = 0; ch < channels; ch++) {
+		auto freq = 1000.0 + 250.0 * ch;
+		double integrator1 = 0.0;
+		double integrator2 = 0.0;
+		double feedback = 0.0;
+		for (auto sample = 0; sample < dsd_samples; sample++) {
+			uint8_t dsd_byte = 0;
+			for (auto bit = 0; bit < 8; bit++) {
+				auto x = 0.5 * sin(2.0 * M_PI * freq * (8.0 * sample + bit) / dsd_rate);
+				integrator1 += x - feedback;
+				integrator2 += integrator1 - feedback;
+				feedback = (integrator2 >= 0.0) ? 1.0 : -1.0;
+				dsd_byte = (uint8_t)((dsd_byte << 1) | ((feedback > 0.0) ? 1 : 0));
+			}
+			dsd_stream[(size_t)sample * channels + ch] = dsd_byte;
+		}
+	}
+	return dsd_stream;
+}
+
+static bool load_dsd_stream(const string& path, int frame_bytes, vector<uint8_t>& dsd_stream) {
+	auto file = fopen(path.c_str(), "rb");
+	if (!file) {
+		fprintf(stderr, "Error: can't open %s\n", path.c_str());
+		return false;
+	}
+	dsd_stream.clear();
+	uint8_t buffer[65536];
+	size_t read_bytes;
+	while ((read_bytes = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		dsd_stream.insert(dsd_stream.end(), buffer, buffer + read_bytes);
+	}
+	fclose(file);
+	dsd_stream.resize(dsd_stream.size() / frame_bytes * frame_bytes);
+	if (dsd_stream.empty()) {
+		fprintf(stderr, "Error: %s holds less than one frame\n", path.c_str());
+		return false;
+	}
+	return true;
+}
+
+static bool run_bench(const bench_options_t& options, int dsd_rate, int pcm_rate, conv_type_e type, conv_precision_e precision, int channels, bench_result_t& result) {
+	auto conv_rate = (pcm_rate % 48000 == 0) ? pcm_rate / PCMRESAMPLER_INTERPOLATION * PCMRESAMPLER_DECIMATION : pcm_rate;
+	auto decimation = dsd_rate / conv_rate;
+	if (dsd_rate % conv_rate != 0 || decimation < 8 || decimation > 1024 || (decimation & (decimation - 1)) != 0) {
+		return false;
+	}
+	auto frame_bytes = dsd_rate / 8 / BENCH_FRAMERATE * channels;
+	vector<uint8_t> dsd_stream;
+	if (options.input.empty()) {
+		dsd_stream = make_dsd_stream(dsd_rate, channels);
+	}
+	else if (!load_dsd_stream(options.input, frame_bytes, dsd_stream)) {
+		return false;
+	}
+	auto frames = (int)ceil(options.seconds * BENCH_FRAMERATE);
+	auto stream_frames = (int)(dsd_stream.size() / frame_bytes);
+
+	DSDPCMConverterEngine engine;
+	engine.set_output_format(pcm_format_e::FLOAT, false);
+	engine.set_frame_parallel(options.frame_parallel);
+	engine.set_channel_group(options.channel_group);
+	engine.set_filter_phase(options.min_phase ? filter_phase_e::MINIMUM : filter_phase_e::LINEAR);
+	if (engine.init(channels, BENCH_FRAMERATE, dsd_rate, pcm_rate, type, precision, nullptr, 0) < 0) {
+		return false;
+	}
+	vector<float> pcm_data((size_t)frame_bytes * 2);
+	double engine_time = 0.0;
+	int64_t pcm_samples = 0;
+	for (auto frame = 0; frame <= frames; frame++) {
+		// The lead-in frame is left out, as in the engine load
+		auto frame_data = dsd_stream.data() + (size_t)(frame % stream_frames) * frame_bytes;
+		auto start = bench_clock_t::now();
+		auto samples = engine.convert(frame_data, frame_bytes, pcm_data.data());
+		if (frame > 0) {
+			engine_time += elapsed(start);
+			pcm_samples += samples;
+		}
+	}
+	if (pcm_samples <= 0) {
+		return false;
+	}
+
+	double dsd_fir_time = 0.0;
+	double conv_time = 0.0;
+	if (precision == conv_precision_e::FP64) {
+		run_stages<double>(options, type, decimation, channels, dsd_stream, frame_bytes, frames, dsd_fir_time, conv_time);
+	}
+	else if (precision == conv_precision_e::INT32) {
+		run_stages<int32_t>(options, type, decimation, channels, dsd_stream, frame_bytes, frames, dsd_fir_time, conv_time);
+	}
+	else {
+		run_stages<float>(options, type, decimation, channels, dsd_stream, frame_bytes, frames, dsd_fir_time, conv_time);
+	}
+
+	result.dsd_rate = dsd_rate;
+	result.pcm_rate = pcm_rate;
+	result.decimation = decimation;
+	result.type = type;
+	result.precision = precision;
+	result.channels = channels;
+	result.seconds = (double)frames / BENCH_FRAMERATE;
+	result.ns_per_sample = engine_time * 1e9 / pcm_samples;
+	result.rt_factor = result.seconds / engine_time;
+	result.dsd_fir_ns = dsd_fir_time * 1e9 / pcm_samples;
+	result.pcm_fir_ns = (conv_time > dsd_fir_time) ? (conv_time - dsd_fir_time) * 1e9 / pcm_samples : 0.0;
+	result.output_ns = (engine_time > conv_time) ? (engine_time - conv_time) * 1e9 / pcm_samples : 0.0;
+	return true;
+}
+
+static void print_result(const bench_options_t& options, const bench_result_t& result, bool first) {
+	if (options.json) {
+		printf("%s\n  {\"dsd_rate\": %d, \"pcm_rate\": %d, \"decimation\": %d, \"type\": \"%s\", \"precision\": \"%s\", \"channels\": %d, \"seconds\": %.2f, \"ns_per_sample\": %.3f, \"rt_factor\": %.2f, \"dsd_fir_ns\": %.3f, \"pcm_fir_ns\": %.3f, \"output_ns\": %.3f}",
+			first ? "" : ",", result.dsd_rate, result.pcm_rate, result.decimation, type_name(result.type), precision_name(result.precision), result.channels, result.seconds, result.ns_per_sample, result.rt_factor, result.dsd_fir_ns, result.pcm_fir_ns, result.output_ns);
+	}
+	else {
+		printf("%d,%d,%d,%s,%s,%d,%.2f,%.3f,%.2f,%.3f,%.3f,%.3f\n",
+			result.dsd_rate, result.pcm_rate, result.decimation, type_name(result.type), precision_name(result.precision), result.channels, result.seconds, result.ns_per_sample, result.rt_factor, result.dsd_fir_ns, result.pcm_fir_ns, result.output_ns);
+	}
+	fflush(stdout);
+}
+
+template<typename value_t>
+static bool parse_list(const char* arg, vector<value_t>& values, bool (*parse_value)(const string&, value_t&)) {
+	values.clear();
+	string list = arg;
+	size_t pos = 0;
+	while (pos <= list.size()) {
+		auto end = list.find(',', pos);
+		end = (end == string::npos) ? list.size() : end;
+		value_t value;
+		if (!parse_value(list.substr(pos, end - pos), value)) {
+			return false;
+		}
+		values.push_back(value);
+		pos = end + 1;
+	}
+	return !values.empty();
+}
+
+static bool parse_int(const string& text, int& value) {
+	char* end;
+	value = (int)strtol(text.c_str(), &end, 10);
+	return !text.empty() && *end == '\0' && value > 0;
+}
+
+static bool parse_type(const string& text, conv_type_e& value) {
+	value = (text == "multistage") ? conv_type_e::MULTISTAGE : (text == "direct") ? conv_type_e::DIRECT : conv_type_e::UNKNOWN;
+	return value != conv_type_e::UNKNOWN;
+}
+
+static bool parse_precision(const string& text, conv_precision_e& value) {
+	if (text == "fp32" || text == "fp64" || text == "int32") {
+		value = (text == "fp64") ? conv_precision_e::FP64 : (text == "int32") ? conv_precision_e::INT32 : conv_precision_e::FP32;
+		return true;
+	}
+	return false;
+}
+
+static void print_usage() {
+	fprintf(stderr,
+		"Usage: dsdpcm_bench [options]\n"
+		"  --dsd 64,128,256              DSD rates in multiples of 44.1 kHz (DSD64, DSD128, ...)\n"
+		"  --pcm 44100,88200,176400,...  PCM output rates, 48 kHz family rates go through the resampler\n"
+		"  --type multistage,direct      converter types\n"
+		"  --precision fp32,fp64,int32   converter precisions\n"
+		"  --channels 2,6                channel counts\n"
+		"  --seconds 2                   audio converted per combination\n"
+		"  --input file                  raw channel interleaved DSD bytes, MSB first, instead of the generated sine\n"
+		"  --frame-parallel              convert frame chunks in parallel\n"
+		"  --channel-group               convert all channels in one task\n"
+		"  --min-phase                   use the minimum phase filters\n"
+		"  --json                        print JSON instead of CSV\n");
+}
+
+static bool parse_options(int argc, char* argv[], bench_options_t& options) {
+	for (auto i = 1; i < argc; i++) {
+		string arg = argv[i];
+		auto has_value = i + 1 < argc;
+		if (arg == "--dsd" && has_value) {
+			if (!parse_list<int>(argv[++i], options.dsd_rates, parse_int)) {
+				return false;
+			}
+		}
+		else if (arg == "--pcm" && has_value) {
+			if (!parse_list<int>(argv[++i], options.pcm_rates, parse_int)) {
+				return false;
+			}
+		}
+		else if (arg == "--type" && has_value) {
+			if (!parse_list<conv_type_e>(argv[++i], options.types, parse_type)) {
+				return false;
+			}
+		}
+		else if (arg == "--precision" && has_value) {
+			if (!parse_list<conv_precision_e>(argv[++i], options.precisions, parse_precision)) {
+				return false;
+			}
+		}
+		else if (arg == "--channels" && has_value) {
+			if (!parse_list<int>(argv[++i], options.channels, parse_int)) {
+				return false;
+			}
+		}
+		else if (arg == "--seconds" && has_value) {
+			options.seconds = atof(argv[++i]);
+			if (options.seconds <= 0.0) {
+				return false;
+			}
+		}
+		else if (arg == "--input" && has_value) {
+			options.input = argv[++i];
+		}
+		else if (arg == "--frame-parallel") {
+			options.frame_parallel = true;
+		}
+		else if (arg == "--channel-group") {
+			options.channel_group = true;
+		}
+		else if (arg == "--min-phase") {
+			options.min_phase = true;
+		}
+		else if (arg == "--json") {
+			options.json = true;
+		}
+		else {
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+	bench_options_t options;
+	if (!parse_options(argc, argv, options)) {
+		print_usage();
+		return 1;
+	}
+	if (options.json) {
+		printf("[");
+	}
+	else {
+		printf("dsd_rate,pcm_rate,decimation,type,precision,channels,seconds,ns_per_sample,rt_factor,dsd_fir_ns,pcm_fir_ns,output_ns\n");
+	}
+	auto first = true;
+	for (auto dsd_rate : options.dsd_rates) {
+		for (auto pcm_rate : options.pcm_rates) {
+			for (auto type : options.types) {
+				for (auto precision : options.precisions) {
+					for (auto channels : options.channels) {
+						bench_result_t result;
+						if (run_bench(options, dsd_rate * (BENCH_DSD64_RATE / 64), pcm_rate, type, precision, channels, result)) {
+							print_result(options, result, first);
+							first = false;
+						}
+					}
+				}
+			}
+		}
+	}
+	if (options.json) {
+		printf("\n]\n");
+	}
+	return 0;
+}
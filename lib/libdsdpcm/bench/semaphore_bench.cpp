@@ -0,0 +1,272 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2021 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "semaphore.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+using std::string;
+using std::vector;
+using bench_clock_t = std::chrono::steady_clock;
+
+/*
+* Ping-pong benchmark for the slot semaphore, built outside Kodi.
+* Two threads hand a token back and forth over two semaphores, the answering thread busy works for work_ns
+* before it hands the token back, as a converter or DST slot does before it signals a finished frame.
+* Every combination of spin time and work time gives the wall time per hand-off and the CPU time both threads
+* spend per hand-off, spinning included. Spinning pays off while the hand-off is faster than with spin time 0
+* and the CPU time stays close to the work.
+* The mutex implementation is the condition variable semaphore the slots used before, it does not spin and is run
+* once per work time as the baseline.
+*/
+
+class mutex_semaphore {
+	std::mutex m_mtx;
+	std::condition_variable m_cv;
+	int m_cnt = 0;
+public:
+	void notify() {
+		std::lock_guard<std::mutex> lock(m_mtx);
+		m_cnt++;
+		m_cv.notify_one();
+	}
+	void wait() {
+		std::unique_lock<std::mutex> lock(m_mtx);
+		while (!m_cnt) {
+			m_cv.wait(lock);
+		}
+		m_cnt--;
+	}
+};
+
+struct bench_options_t {
+	vector<string> impls{ "mutex", "spin" };
+	vector<int> spin_times{ 0, 500, 1000, 2000, 5000, 20000, 100000 };
+	vector<int> work_times{ 0, 1000, 10000, 100000 };
+	int  round_trips = 0;
+	bool json = false;
+};
+
+struct bench_result_t {
+	string impl;
+	int    spin_ns;
+	int    work_ns;
+	int    round_trips;
+	double handoff_ns;
+	double cpu_ns;
+};
+
+static double elapsed(bench_clock_t::time_point start) {
+	return std::chrono::duration<double>(bench_clock_t::now() - start).count();
+}
+
+static double cpu_time() {
+#if defined(CLOCK_PROCESS_CPUTIME_ID)
+	timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+#else
+	return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+static void busy_work(int work_ns) {
+	auto start = bench_clock_t::now();
+	while (std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock_t::now() - start).count() < work_ns) {
+	}
+}
+
+template<typename semaphore_t>
+static void run_bench(const string& impl, int spin_ns, int work_ns, int round_trips, bench_result_t& result) {
+	semaphore_t ping;
+	semaphore_t pong;
+	semaphore::spin_time_ns() = spin_ns;
+	std::thread answer([&]() {
+		for (auto trip = 0; trip < round_trips; trip++) {
+			ping.wait();
+			busy_work(work_ns);
+			pong.notify();
+		}
+	});
+	auto cpu_start = cpu_time();
+	auto start = bench_clock_t::now();
+	for (auto trip = 0; trip < round_trips; trip++) {
+		ping.notify();
+		pong.wait();
+	}
+	auto seconds = elapsed(start);
+	answer.join();
+	auto cpu_seconds = cpu_time() - cpu_start;
+	result.impl = impl;
+	result.spin_ns = spin_ns;
+	result.work_ns = work_ns;
+	result.round_trips = round_trips;
+	result.handoff_ns = 1e9 * seconds / (2.0 * round_trips);
+	result.cpu_ns = 1e9 * cpu_seconds / (2.0 * round_trips);
+}
+
+static void print_result(const bench_options_t& options, const bench_result_t& result, bool first) {
+	if (options.json) {
+		printf("%s\n  {\"impl\": \"%s\", \"spin_ns\": %d, \"work_ns\": %d, \"round_trips\": %d, \"handoff_ns\": %.1f, \"cpu_ns\": %.1f}",
+			first ? "" : ",", result.impl.c_str(), result.spin_ns, result.work_ns, result.round_trips, result.handoff_ns, result.cpu_ns);
+	}
+	else {
+		printf("%s,%d,%d,%d,%.1f,%.1f\n", result.impl.c_str(), result.spin_ns, result.work_ns, result.round_trips, result.handoff_ns, result.cpu_ns);
+	}
+	fflush(stdout);
+}
+
+static bool parse_int(const string& text, int& value) {
+	char* end;
+	value = (int)strtol(text.c_str(), &end, 10);
+	return !text.empty() && *end == '\0' && value >= 0;
+}
+
+static bool parse_names(const char* arg, const vector<string>& names, vector<string>& values) {
+	values.clear();
+	string list = arg;
+	size_t pos = 0;
+	while (pos <= list.size()) {
+		auto end = list.find(',', pos);
+		end = (end == string::npos) ? list.size() : end;
+		auto name = list.substr(pos, end - pos);
+		auto known = false;
+		for (const auto& known_name : names) {
+			known = known || name == known_name;
+		}
+		if (!known) {
+			return false;
+		}
+		values.push_back(name);
+		pos = end + 1;
+	}
+	return !values.empty();
+}
+
+static bool parse_list(const char* arg, vector<int>& values) {
+	values.clear();
+	string list = arg;
+	size_t pos = 0;
+	while (pos <= list.size()) {
+		auto end = list.find(',', pos);
+		end = (end == string::npos) ? list.size() : end;
+		int value;
+		if (!parse_int(list.substr(pos, end - pos), value)) {
+			return false;
+		}
+		values.push_back(value);
+		pos = end + 1;
+	}
+	return !values.empty();
+}
+
+static void print_usage() {
+	fprintf(stderr,
+		"Usage: semaphore_bench [options]\n"
+		"  --impl mutex,spin             mutex and condition variable semaphore (baseline), spinning slot semaphore\n"
+		"  --spin 0,500,1000,...         spin times of wait() in ns\n"
+		"  --work 0,1000,10000,100000    busy work in ns before the token is handed back\n"
+		"  --round-trips n               round trips per combination, by default about 0.2 s of work\n"
+		"  --json                        print JSON instead of CSV\n");
+}
+
+static bool parse_options(int argc, char* argv[], bench_options_t& options) {
+	for (auto i = 1; i < argc; i++) {
+		string arg = argv[i];
+		auto has_value = i + 1 < argc;
+		if (arg == "--impl" && has_value) {
+			if (!parse_names(argv[++i], { "mutex", "spin" }, options.impls)) {
+				return false;
+			}
+		}
+		else if (arg == "--spin" && has_value) {
+			if (!parse_list(argv[++i], options.spin_times)) {
+				return false;
+			}
+		}
+		else if (arg == "--work" && has_value) {
+			if (!parse_list(argv[++i], options.work_times)) {
+				return false;
+			}
+		}
+		else if (arg == "--round-trips" && has_value) {
+			if (!parse_int(argv[++i], options.round_trips) || options.round_trips == 0) {
+				return false;
+			}
+		}
+		else if (arg == "--json") {
+			options.json = true;
+		}
+		else {
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+	bench_options_t options;
+	if (!parse_options(argc, argv, options)) {
+		print_usage();
+		return 1;
+	}
+	if (std::thread::hardware_concurrency() < 2) {
+		fprintf(stderr, "semaphore_bench: single core machine, both threads share one core and spinning only delays the other side\n");
+	}
+	if (options.json) {
+		printf("[");
+	}
+	else {
+		printf("impl,spin_ns,work_ns,round_trips,handoff_ns,cpu_ns\n");
+	}
+	auto first = true;
+	for (auto work_ns : options.work_times) {
+		auto round_trips = options.round_trips;
+		if (round_trips == 0) {
+			round_trips = (work_ns > 0) ? 200000000 / work_ns : 200000;
+			round_trips = (round_trips < 1000) ? 1000 : (round_trips > 200000) ? 200000 : round_trips;
+		}
+		for (const auto& impl : options.impls) {
+			if (impl == "mutex") {
+				bench_result_t result;
+				run_bench<mutex_semaphore>(impl, 0, work_ns, round_trips, result);
+				print_result(options, result, first);
+				first = false;
+				continue;
+			}
+			for (auto spin_ns : options.spin_times) {
+				bench_result_t result;
+				run_bench<semaphore>(impl, spin_ns, work_ns, round_trips, result);
+				print_result(options, result, first);
+				first = false;
+			}
+		}
+	}
+	if (options.json) {
+		printf("\n]\n");
+	}
+	return 0;
+}
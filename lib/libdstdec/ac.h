@@ -147,6 +147,99 @@ public:
 
 };
 
+// Same decoder as ac_t, C is kept in the top ABITS bits of a 64-bit window followed by the next code bits.
+// Renormalisation shifts A and the window at once and the code is fetched a word at a time.
+class ac_window_t {
+	static constexpr int CSHIFT = 64 - ABITS;
+	unsigned int A;
+	uint64_t window;
+	int windowbits;
+	int nextbyte;
+public:
+
+	unsigned int getPtableIndex(int PredicVal, int PtableLen) {
+		int j;
+		j = (PredicVal > 0 ? PredicVal : -PredicVal) >> AC_QSTEP;
+		if (j >= PtableLen) {
+			j = PtableLen - 1;
+		}
+		return (unsigned int)j;
+	}
+
+	void decodeBit_Init(uint8_t* cb, int fs) {
+		nextbyte = 0;
+		window = 0;
+		windowbits = 0;
+		refill(cb, fs);
+		// The first bit of the code is 0
+		window <<= 1;
+		windowbits--;
+		A = ONE - 1;
+	}
+
+	void decodeBit_Decode(uint8_t* b, int p, uint8_t* cb, int fs) {
+		unsigned int ap;
+		unsigned int h;
+		// approximate (A * p) with "partial rounding"
+		ap = ((A >> PBITS) | ((A >> (PBITS - 1)) & 1))* p;
+		h = A - ap;
+		auto hw = (uint64_t)h << CSHIFT;
+		if (window >= hw) {
+			*b = 0;
+			window -= hw;
+			A = ap;
+		}
+		else {
+			*b = 1;
+			A = h;
+		}
+		if (A < HALF) {
+			// Shift A up to HALF at once, the window brings as many code bits into C
+			auto shift = count_leading_zeros(A) - CSHIFT;
+			A <<= shift;
+			window <<= shift;
+			windowbits -= (int)shift;
+			if (windowbits < 2 * ABITS) {
+				refill(cb, fs);
+			}
+		}
+	}
+
+	void decodeBit_Flush(uint8_t* b, int p, uint8_t* cb, int fs) {
+		(void)p;
+		(void)cb;
+		auto cbptr = 8 * nextbyte - windowbits + ABITS;
+		*b = (cbptr < fs - 7) ? 0 : 1;
+	}
+
+private:
+	void refill(const uint8_t* cb, int fs) {
+		auto cbbytes = (fs + 7) / 8;
+		if (nextbyte + 8 < cbbytes) {
+			// Same refill as stream_t, the last byte is left to the byte loop
+			uint64_t word = 0;
+			for (auto i = 0; i < 8; i++) {
+				word = (word << 8) | cb[nextbyte + i];
+			}
+			window |= word >> windowbits;
+			auto bytes = (63 - windowbits) / 8;
+			nextbyte += bytes;
+			windowbits += 8 * bytes;
+			return;
+		}
+		// Use new flushing technique; insert zeros past the end of the arithmetic code
+		while (windowbits <= 56) {
+			if (nextbyte < cbbytes) {
+				auto mask = (nextbyte == cbbytes - 1 && fs % 8) ? 0xff << (8 - fs % 8) : 0xff;
+				window |= (uint64_t)(cb[nextbyte] & mask) << (56 - windowbits);
+			}
+			windowbits += 8;
+			nextbyte++;
+		}
+	}
+
+};
+
 }
 
 #endif
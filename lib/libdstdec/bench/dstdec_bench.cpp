@@ -0,0 +1,704 @@
+/*
+* SACD Decoder plugin
+* Copyright (c) 2011-2021 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 2.1 of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with FFmpeg; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "decoder.h"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+using bench_clock_t = std::chrono::steady_clock;
+
+/*
+* Throughput benchmark for the DST decoder, built outside Kodi.
+* Frames are either read from the DST chunk of a DSDIFF file or encoded from a sigma-delta modulated sine:
+* one segment, one filter and one Ptable per channel, both Rice coded. The filter is a linear predictor fitted
+* to the start of each frame, the Ptable is taken from the prediction errors of the whole frame.
+* Per frame the time of the header parse (segmentation, mapping, filters, Ptables, A_Data copy) is given
+* next to the whole decode, which includes the parse.
+* The arithmetic decoders ac_t and ac_window_t are timed on their own over the A_Data of every frame,
+* one bit per channel sample with the probabilities of the first Ptable, and must decode the same bits.
+* The isolated loop only follows the A -> A*p -> compare chain, so the whole decode is timed with both as well:
+* decode_ref_us with ac_t, decode_window_us with ac_window_t and decode_us with the one decoder_t::decode() picks,
+* each as the best of two interleaved passes.
+*/
+
+constexpr int BENCH_FRAMERATE = 75;
+constexpr int BENCH_DSD64_RATE = 2822400;
+constexpr int BENCH_LPC_BITS = 4096;
+
+struct bench_options_t {
+	vector<int> channels{ 2, 6 };
+	int    frames = 375;
+	int    order = 128;
+	string input;
+	bool   json = false;
+};
+
+struct bench_frames_t {
+	string name;
+	unsigned int channels;
+	unsigned int frame_len;
+	vector<vector<uint8_t>> frames;
+};
+
+struct bench_adata_t {
+	vector<uint8_t>      data;
+	int                  len;
+	vector<unsigned int> probs;
+};
+
+static double elapsed(bench_clock_t::time_point start) {
+	return std::chrono::duration<double>(bench_clock_t::now() - start).count();
+}
+
+class bit_writer_t {
+	vector<uint8_t>& m_data;
+	unsigned int     m_bits;
+public:
+	bit_writer_t(vector<uint8_t>& data) : m_data(data) {
+		m_data.clear();
+		m_bits = 0;
+	}
+	unsigned int get_bits() {
+		return m_bits;
+	}
+	void put_bit(unsigned int bit) {
+		if (m_bits % 8 == 0) {
+			m_data.push_back(0);
+		}
+		m_data.back() |= (uint8_t)((bit & 1) << (7 - m_bits % 8));
+		m_bits++;
+	}
+	void put_uint(unsigned int value, unsigned int length) {
+		for (auto i = length; i > 0; i--) {
+			put_bit(value >> (i - 1));
+		}
+	}
+	// A carry out of the arithmetic encoder turns the trailing 1 bits into 0 bits and the last 0 bit into a 1 bit
+	void put_carry() {
+		auto bit = m_bits - 1;
+		while (m_data[bit / 8] & (0x80 >> (bit % 8))) {
+			m_data[bit / 8] &= (uint8_t)~(0x80 >> (bit % 8));
+			bit--;
+		}
+		m_data[bit / 8] |= (uint8_t)(0x80 >> (bit % 8));
+	}
+	void put_rice(int value, unsigned int m) {
+		auto magnitude = (unsigned int)abs(value);
+		for (auto i = 0u; i < (magnitude >> m); i++) {
+			put_bit(0);
+		}
+		put_bit(1);
+		put_uint(magnitude, m);
+		if (magnitude != 0) {
+			put_bit(value < 0);
+		}
+	}
+};
+
+// Encoder side of ac_t::decodeBit_Decode()
+class ac_encoder_t {
+	bit_writer_t& m_bw;
+	unsigned int  m_A;
+	unsigned int  m_L;
+public:
+	ac_encoder_t(bit_writer_t& bw) : m_bw(bw) {
+		m_A = dst::ONE - 1;
+		m_L = 0;
+	}
+	void encode(unsigned int b, unsigned int p) {
+		auto ap = ((m_A >> dst::PBITS) | ((m_A >> (dst::PBITS - 1)) & 1)) * p;
+		auto h = m_A - ap;
+		if (b == 0) {
+			m_L += h;
+			m_A = ap;
+			if (m_L >= (unsigned int)dst::ONE) {
+				m_bw.put_carry();
+				m_L -= dst::ONE;
+			}
+		}
+		else {
+			m_A = h;
+		}
+		while (m_A < (unsigned int)dst::HALF) {
+			m_A <<= 1;
+			m_bw.put_bit(m_L >> (dst::ABITS - 1));
+			m_L = (m_L << 1) & (dst::ONE - 1);
+		}
+	}
+	void flush() {
+		m_bw.put_uint(m_L, dst::ABITS);
+	}
+};
+
+struct bench_channel_t {
+	int coefs[dst::MAXPREDORDER];
+	int16_t tables[16][256];
+	unsigned int ptable[dst::AC_HISMAX];
+	unsigned int ptable_len;
+};
+
+static int get_dsd_bit(const uint8_t* dsd_data, unsigned int channels, unsigned int ch, unsigned int bit) {
+	return (dsd_data[(bit >> 3) * channels + ch] >> (7 - (bit & 7))) & 1;
+}
+
+// Same prediction as filter_kernel_t::run_filter(), the history starts from LT_InitStatus() every frame
+template<typename on_bit_t>
+static void run_prediction(const bench_channel_t& channel, const uint8_t* dsd_data, unsigned int channels, unsigned int ch, unsigned int bits, on_bit_t on_bit) {
+	uint8_t status[16];
+	memset(status, 0xaa, sizeof(status));
+	for (auto bit = 0u; bit < bits; bit++) {
+		int predict = 0;
+		for (auto i = 0; i < 16; i++) {
+			predict += channel.tables[i][status[i]];
+		}
+		auto value = get_dsd_bit(dsd_data, channels, ch, bit);
+		on_bit(bit, (int16_t)predict, value);
+		for (auto i = 15; i > 0; i--) {
+			status[i] = (uint8_t)((status[i] << 1) | (status[i - 1] >> 7));
+		}
+		status[0] = (uint8_t)((status[0] << 1) | value);
+	}
+}
+
+// Levinson-Durbin over the autocorrelation of the first bits as +1/-1, coefficients in 1/128 steps
+static void fit_channel(bench_channel_t& channel, const uint8_t* dsd_data, unsigned int channels, unsigned int ch, unsigned int bits, int order) {
+	auto lpc_bits = (bits < (unsigned int)BENCH_LPC_BITS) ? bits : BENCH_LPC_BITS;
+	vector<double> x(lpc_bits);
+	for (auto bit = 0u; bit < lpc_bits; bit++) {
+		x[bit] = get_dsd_bit(dsd_data, channels, ch, bit) ? 1.0 : -1.0;
+	}
+	vector<double> r(order + 1);
+	for (auto lag = 0; lag <= order; lag++) {
+		for (auto bit = (unsigned int)lag; bit < lpc_bits; bit++) {
+			r[lag] += x[bit] * x[bit - lag];
+		}
+	}
+	r[0] *= 1.0001;
+	vector<double> a(order + 1), prev(order + 1);
+	auto error = r[0];
+	for (auto i = 1; i <= order && error > 0.0; i++) {
+		auto k = r[i];
+		for (auto j = 1; j < i; j++) {
+			k -= a[j] * r[i - j];
+		}
+		k /= error;
+		prev = a;
+		a[i] = k;
+		for (auto j = 1; j < i; j++) {
+			a[j] = prev[j] - k * prev[i - j];
+		}
+		error *= 1.0 - k * k;
+	}
+	for (auto i = 0; i < order; i++) {
+		auto coef = (int)lround(128.0 * a[i + 1]);
+		channel.coefs[i] = (coef < -256) ? -256 : (coef > 255) ? 255 : coef;
+	}
+	for (auto table = 0; table < 16; table++) {
+		for (auto i = 0; i < 256; i++) {
+			int value = 0;
+			for (auto j = 0; j < 8 && table * 8 + j < order; j++) {
+				value += (((i >> j) & 1) * 2 - 1) * channel.coefs[table * 8 + j];
+			}
+			channel.tables[table][i] = (int16_t)value;
+		}
+	}
+	unsigned int counts[dst::AC_HISMAX][2] = {};
+	channel.ptable_len = 1;
+	run_prediction(channel, dsd_data, channels, ch, bits, [&](unsigned int, int16_t predict, int value) {
+		auto index = (unsigned int)abs(predict) >> dst::AC_QSTEP;
+		index = (index < (unsigned int)dst::AC_HISMAX) ? index : dst::AC_HISMAX - 1;
+		counts[index][value ^ (predict < 0)]++;
+		channel.ptable_len = (index + 1 > channel.ptable_len) ? index + 1 : channel.ptable_len;
+	});
+	for (auto i = 0u; i < channel.ptable_len; i++) {
+		auto p = (unsigned int)lround(256.0 * (counts[i][0] + 0.5) / (counts[i][0] + counts[i][1] + 1.0));
+		channel.ptable[i] = (p < 1) ? 1 : (p > 128) ? 128 : p;
+	}
+}
+
+// Residual the decoder turns back into the value with the given predictor of the method (Table 10.13 and 10.14)
+template<typename ct_t>
+static int get_rice_residual(const ct_t& ct, unsigned int method, const int* values, unsigned int index) {
+	int x = 0;
+	for (auto tap = 0u; tap < ct.CPredOrder[method]; tap++) {
+		x += ct.CPredCoef[method][tap] * values[index - tap - 1];
+	}
+	return (x >= 0) ? values[index] + (x + 4) / 8 : values[index] - (-x + 3) / 8;
+}
+
+// Coded_Filter_Coef_Set and Coded_Ptable: the cheapest method and m, values are stored with a bias of value_bias
+template<typename ct_t>
+static void put_coded_table(bit_writer_t& bw, const ct_t& ct, const int* values, unsigned int length, unsigned int value_bits, int value_bias, unsigned int max_m) {
+	auto best_method = 0u;
+	auto best_m = 0u;
+	auto best_bits = ~0u;
+	for (auto method = 0u; method < (unsigned int)dst::NROFFRICEMETHODS; method++) {
+		if (ct.CPredOrder[method] >= length) {
+			continue;
+		}
+		for (auto m = 0u; m <= max_m; m++) {
+			auto bits = ct.CPredOrder[method] * value_bits;
+			for (auto i = ct.CPredOrder[method]; i < length; i++) {
+				auto magnitude = (unsigned int)abs(get_rice_residual(ct, method, values, i));
+				bits += (magnitude >> m) + 1 + m + (magnitude != 0);
+			}
+			if (bits < best_bits) {
+				best_method = method;
+				best_m = m;
+				best_bits = bits;
+			}
+		}
+	}
+	if (best_bits >= length * value_bits) {
+		bw.put_bit(0);
+		for (auto i = 0u; i < length; i++) {
+			bw.put_uint((unsigned int)(values[i] - value_bias) & ((1u << value_bits) - 1), value_bits);
+		}
+		return;
+	}
+	bw.put_bit(1);
+	bw.put_uint(best_method, dst::SIZE_RICEMETHOD);
+	for (auto i = 0u; i < ct.CPredOrder[best_method]; i++) {
+		bw.put_uint((unsigned int)(values[i] - value_bias) & ((1u << value_bits) - 1), value_bits);
+	}
+	bw.put_uint(best_m, dst::SIZE_RICEM);
+	for (auto i = ct.CPredOrder[best_method]; i < length; i++) {
+		bw.put_rice(get_rice_residual(ct, best_method, values, i), best_m);
+	}
+}
+
+static void make_dst_frame(const uint8_t* dsd_data, unsigned int channels, unsigned int frame_len, int order, vector<uint8_t>& frame) {
+	auto bits = frame_len * 8;
+	vector<bench_channel_t> bench_channels(channels);
+	for (auto ch = 0u; ch < channels; ch++) {
+		fit_channel(bench_channels[ch], dsd_data, channels, ch, bits, order);
+	}
+	dst::ft_t ft;
+	dst::pt_t pt;
+	bit_writer_t bw(frame);
+	bw.put_bit(1); // Processing_Mode: DST coded
+	bw.put_bit(1); // Same_Segmentation
+	bw.put_bit(1); // Same_Segm_For_All_Channels
+	bw.put_bit(1); // End_Of_Channel_Segm: one segment
+	bw.put_bit(1); // Same_Mapping
+	bw.put_bit(0); // Same_Maps_For_All_Channels: every channel gets tables of its own
+	for (auto ch = 1u; ch < channels; ch++) {
+		auto element_bits = 0u;
+		while (ch >= (1u << element_bits)) {
+			element_bits++;
+		}
+		bw.put_uint(ch, element_bits);
+	}
+	for (auto ch = 0u; ch < channels; ch++) {
+		bw.put_bit(0); // Half_Prob
+	}
+	for (auto& channel : bench_channels) {
+		bw.put_uint(order - 1, dst::SIZE_CODEDPREDORDER);
+		put_coded_table(bw, ft, channel.coefs, order, dst::SIZE_PREDCOEF, 0, dst::MAX_RICE_M_F);
+	}
+	for (auto& channel : bench_channels) {
+		int entries[dst::AC_HISMAX];
+		for (auto i = 0u; i < channel.ptable_len; i++) {
+			entries[i] = (int)channel.ptable[i];
+		}
+		bw.put_uint(channel.ptable_len - 1, dst::AC_HISBITS);
+		if (channel.ptable_len > 1) {
+			put_coded_table(bw, pt, entries, channel.ptable_len, dst::AC_BITS - 1, 1, dst::MAX_RICE_M_P);
+		}
+		else {
+			channel.ptable[0] = 128;
+		}
+	}
+	// A_Data starts with a 0 bit, the first symbol is the one decoder_t::decode() reads before the first bit
+	bw.put_bit(0);
+	ac_encoder_t ac(bw);
+	auto c = (unsigned int)(bench_channels[0].coefs[0] + (1 << dst::SIZE_PREDCOEF)) & 127;
+	auto reversed = 0u;
+	for (auto i = 0; i < 7; i++) {
+		reversed |= ((c >> i) & 1) << (6 - i);
+	}
+	ac.encode(0, reversed + 1);
+	vector<vector<uint8_t>> residuals(channels, vector<uint8_t>(bits));
+	vector<vector<uint8_t>> probabilities(channels, vector<uint8_t>(bits));
+	for (auto ch = 0u; ch < channels; ch++) {
+		auto& channel = bench_channels[ch];
+		run_prediction(channel, dsd_data, channels, ch, bits, [&](unsigned int bit, int16_t predict, int value) {
+			auto index = (unsigned int)abs(predict) >> dst::AC_QSTEP;
+			index = (index < channel.ptable_len) ? index : channel.ptable_len - 1;
+			residuals[ch][bit] = (uint8_t)(value ^ (predict < 0));
+			probabilities[ch][bit] = (uint8_t)channel.ptable[index];
+		});
+	}
+	for (auto bit = 0u; bit < bits; bit++) {
+		for (auto ch = 0u; ch < channels; ch++) {
+			ac.encode(residuals[ch][bit], probabilities[ch][bit]);
+		}
+	}
+	ac.flush();
+	while (bw.get_bits() % 8 != 0) {
+		bw.put_bit(0);
+	}
+}
+
+// Second order sigma-delta modulator, a half scale sine a few hundred Hz apart on every channel
+static void make_dsd_frame(unsigned int channels, unsigned int frame_len, int frame, vector<uint8_t>& dsd_data, vector<double>& state) {
+	for (auto ch = 0u; ch < channels; ch++) {
+		auto freq = 1000.0 + 250.0 * ch;
+		auto& integrator1 = state[3 * ch + 0];
+		auto& integrator2 = state[3 * ch + 1];
+		auto& feedback = state[3 * ch + 2];
+		for (auto sample = 0u; sample < frame_len; sample++) {
+			uint8_t dsd_byte = 0;
+			for (auto bit = 0; bit < 8; bit++) {
+				auto t = (8.0 * ((double)frame * frame_len + sample) + bit) / BENCH_DSD64_RATE;
+				integrator1 += 0.5 * sin(2.0 * M_PI * freq * t) - feedback;
+				integrator2 += integrator1 - feedback;
+				feedback = (integrator2 >= 0.0) ? 1.0 : -1.0;
+				dsd_byte = (uint8_t)((dsd_byte << 1) | ((feedback > 0.0) ? 1 : 0));
+			}
+			dsd_data[sample * channels + ch] = dsd_byte;
+		}
+	}
+}
+
+static bool make_dst_frames(const bench_options_t& options, unsigned int channels, bench_frames_t& bench_frames) {
+	bench_frames.name = "generated";
+	bench_frames.channels = channels;
+	bench_frames.frame_len = BENCH_DSD64_RATE / 8 / BENCH_FRAMERATE;
+	bench_frames.frames.resize(options.frames);
+	vector<uint8_t> dsd_data(channels * bench_frames.frame_len);
+	vector<double> state(3 * channels);
+	for (auto frame = 0; frame < options.frames; frame++) {
+		make_dsd_frame(channels, bench_frames.frame_len, frame, dsd_data, state);
+		make_dst_frame(dsd_data.data(), channels, bench_frames.frame_len, options.order, bench_frames.frames[frame]);
+	}
+	return true;
+}
+
+static uint64_t get_be(const uint8_t* data, int bytes) {
+	uint64_t value = 0;
+	for (auto i = 0; i < bytes; i++) {
+		value = (value << 8) | data[i];
+	}
+	return value;
+}
+
+/*
+* DSDIFF: FRM8 form of type DSD with the sample rate and channel count in PROP
+* and the frames in the DSTF chunks of the DST chunk.
+*/
+static bool load_dst_frames(const string& path, int max_frames, bench_frames_t& bench_frames) {
+	auto file = fopen(path.c_str(), "rb");
+	if (!file) {
+		fprintf(stderr, "Error: can't open %s\n", path.c_str());
+		return false;
+	}
+	vector<uint8_t> data;
+	uint8_t buffer[65536];
+	size_t read_bytes;
+	while ((read_bytes = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		data.insert(data.end(), buffer, buffer + read_bytes);
+	}
+	fclose(file);
+	if (data.size() < 16 || memcmp(data.data(), "FRM8", 4) != 0 || memcmp(data.data() + 12, "DSD ", 4) != 0) {
+		fprintf(stderr, "Error: %s is not a DSDIFF file\n", path.c_str());
+		return false;
+	}
+	unsigned int samplerate = 0;
+	bench_frames.name = path;
+	bench_frames.channels = 0;
+	bench_frames.frames.clear();
+	auto walk = [&data](size_t begin, size_t end, auto on_chunk) {
+		for (auto pos = begin; pos + 12 <= end; ) {
+			auto size = get_be(data.data() + pos + 4, 8);
+			if (size > end - pos - 12) {
+				break;
+			}
+			on_chunk((const char*)data.data() + pos, pos + 12, (size_t)size);
+			pos += 12 + (size_t)size + (size & 1);
+		}
+	};
+	walk(16, data.size(), [&](const char* id, size_t pos, size_t size) {
+		if (memcmp(id, "PROP", 4) == 0 && size >= 4) {
+			walk(pos + 4, pos + size, [&](const char* prop_id, size_t prop_pos, size_t prop_size) {
+				if (memcmp(prop_id, "FS  ", 4) == 0 && prop_size >= 4) {
+					samplerate = (unsigned int)get_be(data.data() + prop_pos, 4);
+				}
+				if (memcmp(prop_id, "CHNL", 4) == 0 && prop_size >= 2) {
+					bench_frames.channels = (unsigned int)get_be(data.data() + prop_pos, 2);
+				}
+			});
+		}
+		if (memcmp(id, "DST ", 4) == 0) {
+			walk(pos, pos + size, [&](const char* dst_id, size_t dst_pos, size_t dst_size) {
+				if (memcmp(dst_id, "DSTF", 4) == 0 && (int)bench_frames.frames.size() < max_frames) {
+					bench_frames.frames.emplace_back(data.begin() + dst_pos, data.begin() + dst_pos + dst_size);
+				}
+			});
+		}
+	});
+	if (samplerate == 0 || bench_frames.channels == 0 || bench_frames.frames.empty()) {
+		fprintf(stderr, "Error: %s holds no DST frames\n", path.c_str());
+		return false;
+	}
+	bench_frames.frame_len = samplerate / 8 / BENCH_FRAMERATE;
+	return true;
+}
+
+// Same steps as decoder_t::unpack(), returns the A_Data length in bits
+static int parse_dst_frame(dst::fr_t& fr, dst::ft_t& ft, dst::pt_t& pt, vector<array<unsigned int, dst::AC_HISMAX>>& P_one, uint8_t* AData, uint8_t* dsd_data, const vector<uint8_t>& frame) {
+	fr.CalcNrOfBytes = (unsigned int)frame.size();
+	fr.CalcNrOfBits = fr.CalcNrOfBytes * 8;
+	fr.set_data(frame.data(), fr.CalcNrOfBytes);
+	fr.DSTCoded = fr.get_bit();
+	if (!fr.DSTCoded) {
+		fr.get_uint(7);
+		fr.read_dsd_data(dsd_data);
+		return 0;
+	}
+	fr.read_segmentation();
+	fr.read_mapping();
+	fr.read_filter_coef_sets(ft);
+	fr.read_probability_tables(pt, P_one);
+	auto ADataLen = (int)(fr.CalcNrOfBits - fr.get_offset());
+	fr.read_arithmetic_coded_data(AData);
+	return ADataLen;
+}
+
+// Decodes symbols bits from every A_Data, returns a hash of the decoded bits
+template<typename ac_type>
+static uint64_t run_ac(vector<bench_adata_t>& adata, unsigned int symbols) {
+	uint64_t hash = 0;
+	for (auto& frame : adata) {
+		ac_type AC;
+		uint8_t bit;
+		auto probs = frame.probs.size();
+		size_t prob = 0;
+		AC.decodeBit_Init(frame.data.data(), frame.len);
+		for (auto i = 0u; i < symbols; i++) {
+			AC.decodeBit_Decode(&bit, frame.probs[prob], frame.data.data(), frame.len);
+			prob = (prob + 1 < probs) ? prob + 1 : 0;
+			hash = (hash << 1 | hash >> 63) ^ bit;
+		}
+		AC.decodeBit_Flush(&bit, 0, frame.data.data(), frame.len);
+		hash = hash * 31 + bit;
+	}
+	return hash;
+}
+
+// Decodes every frame with decode, keeps the best time and returns a hash of the DSD output
+template<typename decode_t>
+static uint64_t run_decode(const bench_frames_t& bench_frames, vector<uint8_t>& dsd_data, double& decode_time, decode_t decode) {
+	uint64_t hash = 0;
+	auto start = bench_clock_t::now();
+	for (const auto& frame : bench_frames.frames) {
+		decode(frame.data(), (unsigned int)frame.size() * 8, dsd_data.data());
+		for (auto byte : dsd_data) {
+			hash = hash * 31 + byte;
+		}
+	}
+	auto time = elapsed(start);
+	decode_time = (decode_time > 0.0 && decode_time < time) ? decode_time : time;
+	return hash;
+}
+
+static void run_bench(const bench_options_t& options, const bench_frames_t& bench_frames) {
+	auto channels = bench_frames.channels;
+	auto frame_len = bench_frames.frame_len;
+	vector<uint8_t> dsd_data(channels * frame_len);
+	double dst_bytes = 0.0;
+	for (const auto& frame : bench_frames.frames) {
+		dst_bytes += frame.size();
+	}
+
+	dst::fr_t fr;
+	dst::ft_t ft;
+	dst::pt_t pt;
+	vector<array<unsigned int, dst::AC_HISMAX>> P_one(2 * channels);
+	vector<uint8_t> AData(channels * frame_len);
+	fr.init(channels, frame_len);
+	ft.init(2 * channels);
+	pt.init(2 * channels);
+	auto start = bench_clock_t::now();
+	for (const auto& frame : bench_frames.frames) {
+		parse_dst_frame(fr, ft, pt, P_one, AData.data(), dsd_data.data(), frame);
+	}
+	auto parse_time = elapsed(start);
+
+	vector<bench_adata_t> adata;
+	for (const auto& frame : bench_frames.frames) {
+		auto ADataLen = parse_dst_frame(fr, ft, pt, P_one, AData.data(), dsd_data.data(), frame);
+		if (ADataLen > 0) {
+			bench_adata_t frame_adata;
+			frame_adata.data.assign(AData.begin(), AData.begin() + (ADataLen + 7) / 8);
+			frame_adata.len = ADataLen;
+			frame_adata.probs.assign(P_one[0].begin(), P_one[0].begin() + fr.PtableLen[0]);
+			adata.push_back(std::move(frame_adata));
+		}
+	}
+	auto symbols = channels * frame_len * 8;
+	start = bench_clock_t::now();
+	auto ac_ref_hash = run_ac<dst::ac_t>(adata, symbols);
+	auto ac_ref_time = elapsed(start);
+	start = bench_clock_t::now();
+	auto ac_hash = run_ac<dst::ac_window_t>(adata, symbols);
+	auto ac_time = elapsed(start);
+	if (ac_hash != ac_ref_hash) {
+		fprintf(stderr, "Error: ac_window_t and ac_t decode different bits\n");
+	}
+
+	dst::decoder_t decoder;
+	decoder.init(channels, frame_len);
+	double decode_time = 0.0;
+	double decode_ref_time = 0.0;
+	double decode_window_time = 0.0;
+	for (auto pass = 0; pass < 2; pass++) {
+		auto decode_hash = run_decode(bench_frames, dsd_data, decode_time, [&](const uint8_t* dst_data, unsigned int dst_bits, uint8_t* dsd) {
+			return decoder.decode(dst_data, dst_bits, dsd);
+		});
+		auto decode_ref_hash = run_decode(bench_frames, dsd_data, decode_ref_time, [&](const uint8_t* dst_data, unsigned int dst_bits, uint8_t* dsd) {
+			return decoder.decode<dst::ac_t>(dst_data, dst_bits, dsd);
+		});
+		auto decode_window_hash = run_decode(bench_frames, dsd_data, decode_window_time, [&](const uint8_t* dst_data, unsigned int dst_bits, uint8_t* dsd) {
+			return decoder.decode<dst::ac_window_t>(dst_data, dst_bits, dsd);
+		});
+		if (decode_window_hash != decode_ref_hash || decode_hash != decode_ref_hash) {
+			fprintf(stderr, "Error: decoding with ac_window_t and ac_t gives different DSD data\n");
+		}
+	}
+
+	auto frames = (double)bench_frames.frames.size();
+	auto parse_us = parse_time * 1e6 / frames;
+	auto decode_us = decode_time * 1e6 / frames;
+	auto decode_ref_us = decode_ref_time * 1e6 / frames;
+	auto decode_window_us = decode_window_time * 1e6 / frames;
+	auto rt_factor = frames / BENCH_FRAMERATE / decode_time;
+	auto ac_frames = (double)(adata.empty() ? 1 : adata.size());
+	auto ac_ref_us = ac_ref_time * 1e6 / ac_frames;
+	auto ac_us = ac_time * 1e6 / ac_frames;
+	if (options.json) {
+		printf("  {\"source\": \"%s\", \"channels\": %u, \"frame_len\": %u, \"frames\": %d, \"dst_bytes\": %.0f, \"parse_us\": %.3f, \"decode_us\": %.3f, \"rt_factor\": %.2f, \"ac_ref_us\": %.3f, \"ac_us\": %.3f, \"decode_ref_us\": %.3f, \"decode_window_us\": %.3f}",
+			bench_frames.name.c_str(), channels, frame_len, (int)frames, dst_bytes / frames, parse_us, decode_us, rt_factor, ac_ref_us, ac_us, decode_ref_us, decode_window_us);
+	}
+	else {
+		printf("%s,%u,%u,%d,%.0f,%.3f,%.3f,%.2f,%.3f,%.3f,%.3f,%.3f\n",
+			bench_frames.name.c_str(), channels, frame_len, (int)frames, dst_bytes / frames, parse_us, decode_us, rt_factor, ac_ref_us, ac_us, decode_ref_us, decode_window_us);
+	}
+	fflush(stdout);
+}
+
+static bool parse_channels(const char* arg, vector<int>& channels) {
+	channels.clear();
+	string list = arg;
+	size_t pos = 0;
+	while (pos <= list.size()) {
+		auto end = list.find(',', pos);
+		end = (end == string::npos) ? list.size() : end;
+		auto value = atoi(list.substr(pos, end - pos).c_str());
+		if (value < 1 || value > 6) {
+			return false;
+		}
+		channels.push_back(value);
+		pos = end + 1;
+	}
+	return !channels.empty();
+}
+
+static void print_usage() {
+	fprintf(stderr,
+		"Usage: dstdec_bench [options]\n"
+		"  --channels 2,6   channel counts of the generated frames\n"
+		"  --frames 375     frames decoded per run\n"
+		"  --order 128      prediction order of the generated filters\n"
+		"  --input file     DSDIFF file with DST frames instead of generated ones\n"
+		"  --json           print JSON instead of CSV\n");
+}
+
+static bool parse_options(int argc, char* argv[], bench_options_t& options) {
+	for (auto i = 1; i < argc; i++) {
+		string arg = argv[i];
+		auto has_value = i + 1 < argc;
+		if (arg == "--channels" && has_value) {
+			if (!parse_channels(argv[++i], options.channels)) {
+				return false;
+			}
+		}
+		else if (arg == "--frames" && has_value) {
+			options.frames = atoi(argv[++i]);
+			if (options.frames < 1) {
+				return false;
+			}
+		}
+		else if (arg == "--order" && has_value) {
+			options.order = atoi(argv[++i]);
+			if (options.order < 4 || options.order > dst::MAXPREDORDER) {
+				return false;
+			}
+		}
+		else if (arg == "--input" && has_value) {
+			options.input = argv[++i];
+		}
+		else if (arg == "--json") {
+			options.json = true;
+		}
+		else {
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+	bench_options_t options;
+	if (!parse_options(argc, argv, options)) {
+		print_usage();
+		return 1;
+	}
+	vector<bench_frames_t> runs;
+	if (!options.input.empty()) {
+		runs.resize(1);
+		if (!load_dst_frames(options.input, options.frames, runs[0])) {
+			return 1;
+		}
+	}
+	else {
+		runs.resize(options.channels.size());
+		for (size_t i = 0; i < runs.size(); i++) {
+			make_dst_frames(options, options.channels[i], runs[i]);
+		}
+	}
+	printf(options.json ? "[\n" : "source,channels,frame_len,frames,dst_bytes,parse_us,decode_us,rt_factor,ac_ref_us,ac_us,decode_ref_us,decode_window_us\n");
+	for (size_t i = 0; i < runs.size(); i++) {
+		run_bench(options, runs[i]);
+		if (options.json) {
+			printf((i + 1 < runs.size()) ? ",\n" : "\n");
+		}
+	}
+	if (options.json) {
+		printf("]\n");
+	}
+	return 0;
+}
@@ -25,20 +25,14 @@
 
 #define DSD_SILENCE_BYTE 0x69
 
-static void dst_run_thread(frame_slot_t& slot) {
-	while (slot.run_slot) {
-		slot.dst_semaphore.wait();
-		if (slot.run_slot) {
-			slot.state = slot_state_t::SLOT_RUNNING;
-			slot.dec.decode(slot.dst_data, slot.dst_size * 8, slot.dsd_data);
-			slot.state = slot_state_t::SLOT_READY;
-		}
-		else {
-			slot.dsd_data = nullptr;
-			slot.dst_size = 0;
-		}
+static void dst_run_slot(frame_slot_t& slot) {
+	slot.run_slot = true;
+	task_pool_t::get_instance().submit([&slot] {
+		slot.state = slot_state_t::SLOT_RUNNING;
+		slot.dec.decode(slot.dst_data, slot.dst_size * 8, slot.dsd_data);
+		slot.state = slot_state_t::SLOT_READY;
 		slot.dsd_semaphore.notify();
-	}
+	});
 }
 
 dst_decoder_t::dst_decoder_t(unsigned int threads) {
@@ -50,11 +44,12 @@ dst_decoder_t::dst_decoder_t(unsigned int threads) {
 
 dst_decoder_t::~dst_decoder_t() {
 	for (auto& slot : frame_slots) {
+		if (slot.run_slot) {
+			slot.dsd_semaphore.wait(); // Wait until the frame still being decoded on the task pool is complete
+			slot.run_slot = false;
+		}
 		slot.state = slot_state_t::SLOT_TERMINATING;
 		slot.dec.close();
-		slot.run_slot = false;
-		slot.dst_semaphore.notify(); // Release worker (decoding) thread for exit
-		slot.run_thread.join(); // Wait until worker (decoding) thread exit
 	}
 }   
 
@@ -70,12 +65,6 @@ int dst_decoder_t::init(unsigned int channels, unsigned int samplerate, unsigned
 			slot.channel_count = channel_count;
 			slot.channel_frame_size = channel_frame_size;
 			slot.dsd_size = (size_t)(channel_count * channel_frame_size);
-			slot.run_slot = true;
-			slot.run_thread = thread(dst_run_thread, ref(slot));
-			if (!slot.run_thread.joinable()) {
-				kodiLog(ADDON_LOG_ERROR, ("Could not start decoder thread"));
-				return -1;
-			}
 		}
 		else {
 			kodiLog(ADDON_LOG_ERROR, ("Could not initialize decoder slot"));
@@ -98,7 +87,7 @@ int dst_decoder_t::decode(uint8_t* dst_data, size_t dst_size, uint8_t** dsd_data
 	/* Release worker (decoding) thread on the loaded slot */
 	if (dst_size > 0)	{
 		slot_set.state = slot_state_t::SLOT_LOADED;
-		slot_set.dst_semaphore.notify();
+		dst_run_slot(slot_set);
 	}
 	else {
 		slot_set.state = slot_state_t::SLOT_EMPTY;
@@ -111,6 +100,7 @@ int dst_decoder_t::decode(uint8_t* dst_data, size_t dst_size, uint8_t** dsd_data
 	/* Dump decoded frame */
 	if (slot_get.state != slot_state_t::SLOT_EMPTY) {
 		slot_get.dsd_semaphore.wait();
+		slot_get.run_slot = false;
 	}
 	switch (slot_get.state) {
 	case slot_state_t::SLOT_READY:
@@ -20,14 +20,12 @@
 #ifndef _DST_DECODER_MT_H_INCLUDED
 #define _DST_DECODER_MT_H_INCLUDED
 
-#include <thread>
 #include <vector>
-#include <semaphore.h>
+#include "semaphore.h"
+#include "task_pool.h"
 #include "decoder.h"
 
-using std::thread;
 using std::vector;
-using std::ref;
 using dst::decoder_t;
 
 enum class slot_state_t {SLOT_EMPTY, SLOT_LOADED, SLOT_RUNNING, SLOT_READY, SLOT_READY_WITH_ERROR, SLOT_TERMINATING};
@@ -35,9 +33,7 @@ enum class slot_state_t {SLOT_EMPTY, SLOT_LOADED, SLOT_RUNNING, SLOT_READY, SLOT
 class frame_slot_t {
 public:
 	bool         run_slot;
-	thread       run_thread;
 	semaphore    dsd_semaphore;
-	semaphore    dst_semaphore;
 
 	slot_state_t state;
 	uint8_t*     dsd_data;
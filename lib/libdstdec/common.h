@@ -6,8 +6,25 @@
 #ifndef COMMON_H
 #define COMMON_H
 
+#ifdef BUILD_KODI_ADDON
 #include <kodi/General.h>
+#else
+#include <stdarg.h>
+#include <stdio.h>
+
+typedef enum ADDON_LOG
+{
+  ADDON_LOG_DEBUG = 0,
+  ADDON_LOG_INFO = 1,
+  ADDON_LOG_WARNING = 2,
+  ADDON_LOG_ERROR = 3,
+  ADDON_LOG_FATAL = 4
+} ADDON_LOG;
+#endif
 #include <stdint.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 namespace
 {
@@ -40,10 +57,14 @@ inline void kodiLog(const ADDON_LOG logLevel, const char* format, ...)
   vsprintf(buffer, format, args);
   va_end(args);
 
+#ifdef BUILD_KODI_ADDON
   kodi::Log(logLevel, buffer);
 #ifdef DEBUG
   fprintf(stderr, "%s%s\n", kodiTranslateLogLevel(logLevel), buffer);
 #endif
+#else
+  fprintf(stderr, "%s%s\n", kodiTranslateLogLevel(logLevel), buffer);
+#endif
 }
 
 }
@@ -58,6 +79,17 @@ static auto GET_NIBBLE = [](auto base, auto index) {
 	return (((unsigned char*)base)[index >> 1] >> ((index & 1) << 2)) & 0x0f;
 };
 
+// Number of 0 bits above the highest 1 bit, value must not be 0
+static inline unsigned int count_leading_zeros(uint64_t value) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return 63 - (unsigned int)index;
+#else
+	return (unsigned int)__builtin_clzll(value);
+#endif
+}
+
 }
 
 #endif
@@ -53,6 +53,8 @@ int decoder_t::init(unsigned int channels, unsigned int channel_frame_size) {
 	AData.resize(channels * channel_frame_size);
 	LT_ICoefI.resize(2 * channels);
 	LT_Status.resize(channels);
+	LT_Filter.resize(channels);
+	LT_Predict.resize(channels);
 	return 0;
 }
 
@@ -61,6 +63,15 @@ int decoder_t::close() {
 }
 
 // Decode a complete frame (all channels)
+int decoder_t::decode(const uint8_t* dst_data, unsigned int dst_bits, uint8_t* dsd_data) {
+	if (m_fr.NrOfChannels < AC_WINDOW_MIN_CHANNELS) {
+		return decode<ac_t>(dst_data, dst_bits, dsd_data);
+	}
+	return decode<ac_window_t>(dst_data, dst_bits, dsd_data);
+}
+
+// Decode a complete frame with the given arithmetic decoder
+template<typename ac_type>
 int decoder_t::decode(const uint8_t* dst_data, unsigned int dst_bits, uint8_t* dsd_data) {
 	int     rv = 0;
 	uint8_t ACError;
@@ -78,27 +89,30 @@ int decoder_t::decode(const uint8_t* dst_data, unsigned int dst_bits, uint8_t* d
 	}
 
 	if (m_fr.DSTCoded == 1) {
-		ac_t AC;
+		ac_type AC;
 
 		fillTable4Bit(m_fr.FSegment, m_fr.Filter4Bit);
 		fillTable4Bit(m_fr.PSegment, m_fr.Ptable4Bit);
 
 		GC_InitCoefTables(LT_ICoefI);
 		LT_InitStatus(LT_Status);
+		LT_RunFilters = filter_kernel_t::get_run_filters(NrOfChannels, LT_MaxTables);
 
 		AC.decodeBit_Init(AData.data(), ADataLen);
 		AC.decodeBit_Decode(&ACError, reverse7LSBs(m_fr.ICoefA[0][0]), AData.data(), ADataLen);
 
 		memset(dsd_data, 0, (NrOfBitsPerCh * NrOfChannels + 7) / 8);
 		for (auto BitNr = 0u; BitNr < NrOfBitsPerCh; BitNr++) {
+			/* Calculate output value of the FIR filter of every channel */
+			for (auto ChNr = 0u; ChNr < NrOfChannels; ChNr++) {
+				LT_Filter[ChNr] = &LT_ICoefI[GET_NIBBLE(m_fr.Filter4Bit[ChNr].data(), BitNr)];
+			}
+			LT_RunFilters(LT_Filter.data(), LT_Status.data(), NrOfChannels, LT_Predict.data());
+
 			for (auto ChNr = 0u; ChNr < NrOfChannels; ChNr++) {
-				int16_t Predict;
+				int16_t Predict = LT_Predict[ChNr];
 				uint8_t Residual;
 				int16_t BitVal;
-				auto FilterNr = GET_NIBBLE(m_fr.Filter4Bit[ChNr].data(), BitNr);
-
-				/* Calculate output value of the FIR filter */
-				Predict = LT_RunFilter(LT_ICoefI[FilterNr], LT_Status[ChNr]);
 
 				/* Arithmetic decode the incoming bit */
 				if ((m_fr.HalfProb[ChNr]/* == 1*/) && (BitNr < m_fr.NrOfHalfBits[ChNr])) {
@@ -117,11 +131,7 @@ int decoder_t::decode(const uint8_t* dst_data, unsigned int dst_bits, uint8_t* d
 				dsd_data[(BitNr >> 3) * NrOfChannels + ChNr] |= (uint8_t)(BitVal << (7 - (BitNr & 7)));
 
 				/* Update filter */
-				{
-					uint64_t* const st = reinterpret_cast<uint64_t*>(LT_Status[ChNr].data());
-					st[1] = (st[1] << 1) | (st[0] >> 63);
-					st[0] = (st[0] << 1) | BitVal;
-				}
+				LT_Status[ChNr].push(BitVal);
 			}
 		}
 
@@ -137,6 +147,9 @@ int decoder_t::decode(const uint8_t* dst_data, unsigned int dst_bits, uint8_t* d
 	return rv;
 }
 
+template int decoder_t::decode<ac_t>(const uint8_t* dst_data, unsigned int dst_bits, uint8_t* dsd_data);
+template int decoder_t::decode<ac_window_t>(const uint8_t* dst_data, unsigned int dst_bits, uint8_t* dsd_data);
+
 // Read a complete frame from the DST input stream
 int decoder_t::unpack(const uint8_t* dst_data, uint8_t* dsd_data) {
 	m_fr.set_data(dst_data, m_fr.CalcNrOfBytes); // Assign DST data from input stream
@@ -209,8 +222,12 @@ void decoder_t::fillTable4Bit(segment_t& S, vector<vector<uint8_t>>& Table4Bit)
 	}
 }
 
-void decoder_t::LT_InitCoefTables(vector<array<array<int16_t, 256>, 16>>& ICoefI) {
+void decoder_t::LT_InitCoefTables(vector<lt_filter_t>& ICoefI) {
+	LT_MaxTables = 0;
 	for (auto FilterNr = 0u; FilterNr < m_fr.NrOfFilters; FilterNr++) {
+		if (!LT_InitCoefs(ICoefI[FilterNr], FilterNr)) {
+			continue;
+		}
 		auto FilterLength = m_fr.PredOrder[FilterNr];
 		for (auto TableNr = 0u; TableNr < 16u; TableNr++) {
 			auto k = (int)FilterLength - (int)TableNr * 8;
@@ -225,14 +242,18 @@ void decoder_t::LT_InitCoefTables(vector<array<array<int16_t, 256>, 16>>& ICoefI
 				for (auto j = 0; j < k; j++) {
 					cvalue += (((i >> j) & 1) * 2 - 1) * m_fr.ICoefA[FilterNr][TableNr * 8 + j];
 				}
-				ICoefI[FilterNr][TableNr][i] = (int16_t)cvalue;
+				ICoefI[FilterNr].table[TableNr][i] = (int16_t)cvalue;
 			}
 		}
 	}
 }
 
-void decoder_t::GC_InitCoefTables(vector<array<array<int16_t, 256>, 16>>& ICoefI) {
+void decoder_t::GC_InitCoefTables(vector<lt_filter_t>& ICoefI) {
+	LT_MaxTables = 0;
 	for (auto FilterNr = 0u; FilterNr < m_fr.NrOfFilters; FilterNr++) {
+		if (!LT_InitCoefs(ICoefI[FilterNr], FilterNr)) {
+			continue;
+		}
 		auto FilterLength = m_fr.PredOrder[FilterNr];
 		for (auto TableNr = 0u; TableNr < 16u; TableNr++) {
 			auto k = (int)FilterLength - (int)TableNr * 8;
@@ -246,46 +267,53 @@ void decoder_t::GC_InitCoefTables(vector<array<array<int16_t, 256>, 16>>& ICoefI
 			for (auto j = 0; j < k; j++) {
 				cvalue -= m_fr.ICoefA[FilterNr][TableNr * 8 + j];
 			}
-			ICoefI[FilterNr][TableNr][0] = (int16_t)cvalue;
+			ICoefI[FilterNr].table[TableNr][0] = (int16_t)cvalue;
 			for (auto i = 1; i < 256; i++) {
 				auto i_gray = i ^ (i >> 1);
 				auto j_gray = GC_ICoefIndex[i];
 				if (j_gray < (unsigned int)k) {
 					cvalue += GC_ICoefSign[i] * (m_fr.ICoefA[FilterNr][TableNr * 8 + j_gray] << 1);
 				}
-				ICoefI[FilterNr][TableNr][i_gray] = (int16_t)cvalue;
+				ICoefI[FilterNr].table[TableNr][i_gray] = (int16_t)cvalue;
 			}
 		}
 	}
 }
 
-void decoder_t::LT_InitStatus(vector<array<uint8_t, 16>>& Status) {
-	for (auto ChNr = 0u; ChNr < m_fr.NrOfChannels; ChNr++) {
-		for (auto TableNr = 0u; TableNr < 16u; TableNr++) {
-			Status[ChNr][TableNr] = 0xaa;
-		}
+/*
+* Copy the taps next to the tables for the kernels that use them directly.
+* The tables depend on the taps only, if a filter has the same taps as in the previous frame
+* its tables are kept and false is returned.
+*/
+
+bool decoder_t::LT_InitCoefs(lt_filter_t& ICoefI, unsigned int FilterNr) {
+	auto FilterLength = m_fr.PredOrder[FilterNr];
+	auto Tables = (int16_t)((FilterLength + 31) / 32 * 4);
+	if (LT_MaxTables < (unsigned int)Tables) {
+		LT_MaxTables = Tables;
 	}
+	int16_t Coef[128];
+	for (auto CoefNr = 0u; CoefNr < 128u; CoefNr++) {
+		Coef[CoefNr] = (CoefNr < FilterLength) ? m_fr.ICoefA[FilterNr][CoefNr] : 0;
+	}
+	if (ICoefI.tables == Tables && memcmp(ICoefI.coef, Coef, sizeof(Coef)) == 0) {
+		return false;
+	}
+	int coef_sum = 0;
+	for (auto CoefNr = 0u; CoefNr < 128u; CoefNr++) {
+		ICoefI.coef[CoefNr] = Coef[CoefNr];
+		coef_sum += Coef[CoefNr];
+	}
+	ICoefI.coef_sum = (int16_t)coef_sum;
+	ICoefI.tables = Tables;
+	return true;
 }
 
-int16_t decoder_t::LT_RunFilter(array<array<int16_t, 256>, 16>& FilterTable, array<uint8_t, 16>& ChannelStatus) {
-	int Predict;
-	Predict = FilterTable[0][ChannelStatus[0]];
-	Predict += FilterTable[1][ChannelStatus[1]];
-	Predict += FilterTable[2][ChannelStatus[2]];
-	Predict += FilterTable[3][ChannelStatus[3]];
-	Predict += FilterTable[4][ChannelStatus[4]];
-	Predict += FilterTable[5][ChannelStatus[5]];
-	Predict += FilterTable[6][ChannelStatus[6]];
-	Predict += FilterTable[7][ChannelStatus[7]];
-	Predict += FilterTable[8][ChannelStatus[8]];
-	Predict += FilterTable[9][ChannelStatus[9]];
-	Predict += FilterTable[10][ChannelStatus[10]];
-	Predict += FilterTable[11][ChannelStatus[11]];
-	Predict += FilterTable[12][ChannelStatus[12]];
-	Predict += FilterTable[13][ChannelStatus[13]];
-	Predict += FilterTable[14][ChannelStatus[14]];
-	Predict += FilterTable[15][ChannelStatus[15]];
-	return (int16_t)Predict;
+void decoder_t::LT_InitStatus(vector<lt_status_t>& Status) {
+	for (auto ChNr = 0u; ChNr < m_fr.NrOfChannels; ChNr++) {
+		Status[ChNr].word[0] = 0xaaaaaaaaaaaaaaaa;
+		Status[ChNr].word[1] = 0xaaaaaaaaaaaaaaaa;
+	}
 }
 
 }
@@ -15,6 +15,7 @@
 #include "ac.h"
 #include "fr.h"
 #include "stream.h"
+#include "filter_kernel.h"
 
 using std::array;
 using std::vector;
@@ -22,7 +23,13 @@ using std::vector;
 namespace dst
 {
 
+/*
+* The arithmetic decoder is picked by channel count. On its own ac_window_t is slower than ac_t, the A -> A*p -> compare
+* chain gets longer. Within the whole decode its cheaper renormalisation wins from AC_WINDOW_MIN_CHANNELS channels on,
+* with fewer channels ac_t is as fast or faster (see dstdec_bench).
+*/
 class decoder_t {
+	static constexpr unsigned int AC_WINDOW_MIN_CHANNELS = 3;
 	static int          GC_ICoefSign[256];
 	static unsigned int GC_ICoefIndex[256];
 	static bool         GC_ICoefInit;
@@ -33,22 +40,27 @@ public:
 	vector<array<unsigned int, AC_HISMAX>> P_one; // Probability table for arithmetic coder
 	vector<uint8_t> AData;                        // Contains the arithmetic coded bit stream of a complete frame	vector<uint8_t> AData;               // Contains the arithmetic coded bit stream of a complete frame
 	int             ADataLen;                     // Number of code bits contained in AData[]
-	vector<array<array<int16_t, 256>, 16>> LT_ICoefI;
-	vector<array<uint8_t, 16>>             LT_Status;
+	vector<lt_filter_t>                   LT_ICoefI;
+	vector<lt_status_t>                   LT_Status;
+	vector<const lt_filter_t*>            LT_Filter;      // Filter of every channel for the current bit
+	vector<int16_t>                       LT_Predict;     // Prediction of every channel for the current bit
+	unsigned int                          LT_MaxTables;   // Tables used by the longest filter of the frame
+	filter_kernel_t::run_filters_t        LT_RunFilters;
 public:
 	decoder_t();
 	~decoder_t();
 	int init(unsigned int channels, unsigned int channel_frame_size);
 	int close();
 	int decode(const uint8_t* dst_data, unsigned int dst_bits, uint8_t* dsd_data);
+	template<typename ac_type> int decode(const uint8_t* dst_data, unsigned int dst_bits, uint8_t* dsd_data);
 private:
 	int unpack(const uint8_t* dst_data, uint8_t* dsd_data);
 	int16_t reverse7LSBs(int16_t c);
 	void fillTable4Bit(segment_t& S, vector<vector<uint8_t>>& Table4Bit);
-	void LT_InitCoefTables(vector<array<array<int16_t, 256>, 16>>& ICoefI);
-	void GC_InitCoefTables(vector<array<array<int16_t, 256>, 16>>& ICoefI);
-	void LT_InitStatus(vector<array<uint8_t, 16>>& Status);
-	int16_t LT_RunFilter(array<array<int16_t, 256>, 16>& FilterTable, array<uint8_t, 16>& ChannelStatus);
+	void LT_InitCoefTables(vector<lt_filter_t>& ICoefI);
+	void GC_InitCoefTables(vector<lt_filter_t>& ICoefI);
+	bool LT_InitCoefs(lt_filter_t& ICoefI, unsigned int FilterNr);
+	void LT_InitStatus(vector<lt_status_t>& Status);
 };
 
 }
@@ -0,0 +1,179 @@
+/*
+* Direct Stream Transfer (DST) codec
+* ISO/IEC 14496-3 Part 3 Subpart 10: Technical description of lossless coding of oversampled audio
+*/
+
+#include "filter_kernel.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define DST_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define DST_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define DST_TARGET(isa) __attribute__((target(isa)))
+#else
+#define DST_TARGET(isa)
+#endif
+
+namespace dst
+{
+
+#ifdef DST_X86
+
+#if defined(_MSC_VER) && !defined(__clang__)
+static bool cpu_has_xsave_state(unsigned long long mask) {
+	int info[4];
+	__cpuid(info, 1);
+	if (!(info[2] & (1 << 27))) { // OSXSAVE
+		return false;
+	}
+	return (_xgetbv(0) & mask) == mask;
+}
+static bool cpu_has_avx2() {
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7 || !cpu_has_xsave_state(0x06)) {
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+}
+static bool cpu_has_avx512bw() {
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7 || !cpu_has_xsave_state(0xe6)) {
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 16)) != 0 && (info[1] & (1 << 30)) != 0;
+}
+#else
+static bool cpu_has_avx2() {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+static bool cpu_has_avx512bw() {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+}
+#endif
+
+// The 16-bit entries are gathered as 32-bit words, the upper halves are summed along and dropped at the end
+DST_TARGET("avx2")
+static inline int16_t run_filter_avx2(const lt_filter_t& filter, const lt_status_t& status) {
+	const __m256i offsets = _mm256_slli_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), 8);
+	auto base = reinterpret_cast<const int*>(filter.table);
+	__m128i bytes = _mm_load_si128(reinterpret_cast<const __m128i*>(status.word));
+	__m256i index0 = _mm256_add_epi32(_mm256_cvtepu8_epi32(bytes), offsets);
+	__m256i acc = _mm256_i32gather_epi32(base, index0, sizeof(int16_t));
+	if (filter.tables > 8) {
+		__m256i index1 = _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8)), _mm256_add_epi32(offsets, _mm256_set1_epi32(8 * 256)));
+		acc = _mm256_add_epi32(acc, _mm256_i32gather_epi32(base, index1, sizeof(int16_t)));
+	}
+	__m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+	return (int16_t)_mm_cvtsi128_si32(sum);
+}
+
+// Every 32 status bits mask 32 taps, no table is read
+DST_TARGET("avx512f,avx512bw")
+static inline int16_t run_filter_avx512bw(const lt_filter_t& filter, const lt_status_t& status) {
+	auto coef = reinterpret_cast<const __m512i*>(filter.coef);
+	__m512i acc = _mm512_maskz_mov_epi16((__mmask32)status.word[0], _mm512_load_si512(coef + 0));
+	if (filter.tables > 4) {
+		acc = _mm512_mask_add_epi16(acc, (__mmask32)(status.word[0] >> 32), acc, _mm512_load_si512(coef + 1));
+		if (filter.tables > 8) {
+			acc = _mm512_mask_add_epi16(acc, (__mmask32)status.word[1], acc, _mm512_load_si512(coef + 2));
+			if (filter.tables > 12) {
+				acc = _mm512_mask_add_epi16(acc, (__mmask32)(status.word[1] >> 32), acc, _mm512_load_si512(coef + 3));
+			}
+		}
+	}
+	auto sum = _mm512_reduce_add_epi32(_mm512_madd_epi16(acc, _mm512_set1_epi16(1)));
+	return (int16_t)(2 * sum - filter.coef_sum);
+}
+
+DST_TARGET("avx2")
+static void run_filters_avx2(const lt_filter_t* const* filters, const lt_status_t* status, unsigned int channels, int16_t* predict) {
+	for (auto ChNr = 0u; ChNr < channels; ChNr++) {
+		predict[ChNr] = run_filter_avx2(*filters[ChNr], status[ChNr]);
+	}
+}
+
+DST_TARGET("avx512f,avx512bw")
+static void run_filters_avx512bw(const lt_filter_t* const* filters, const lt_status_t* status, unsigned int channels, int16_t* predict) {
+	for (auto ChNr = 0u; ChNr < channels; ChNr++) {
+		predict[ChNr] = run_filter_avx512bw(*filters[ChNr], status[ChNr]);
+	}
+}
+
+#endif
+
+#ifdef DST_NEON
+
+// NEON has no gather, the lanes are loaded one by one and summed with 16-bit wrap around
+static inline int16_t run_filter_neon(const lt_filter_t& filter, const lt_status_t& status) {
+	auto bytes = status.bytes();
+	int16x8_t v0 = vdupq_n_s16(0);
+	int16x8_t v1 = vdupq_n_s16(0);
+	v0 = vld1q_lane_s16(&filter.table[0][bytes[0]], v0, 0);
+	v0 = vld1q_lane_s16(&filter.table[1][bytes[1]], v0, 1);
+	v0 = vld1q_lane_s16(&filter.table[2][bytes[2]], v0, 2);
+	v0 = vld1q_lane_s16(&filter.table[3][bytes[3]], v0, 3);
+	v0 = vld1q_lane_s16(&filter.table[4][bytes[4]], v0, 4);
+	v0 = vld1q_lane_s16(&filter.table[5][bytes[5]], v0, 5);
+	v0 = vld1q_lane_s16(&filter.table[6][bytes[6]], v0, 6);
+	v0 = vld1q_lane_s16(&filter.table[7][bytes[7]], v0, 7);
+	if (filter.tables > 8) {
+		v1 = vld1q_lane_s16(&filter.table[8][bytes[8]], v1, 0);
+		v1 = vld1q_lane_s16(&filter.table[9][bytes[9]], v1, 1);
+		v1 = vld1q_lane_s16(&filter.table[10][bytes[10]], v1, 2);
+		v1 = vld1q_lane_s16(&filter.table[11][bytes[11]], v1, 3);
+		v1 = vld1q_lane_s16(&filter.table[12][bytes[12]], v1, 4);
+		v1 = vld1q_lane_s16(&filter.table[13][bytes[13]], v1, 5);
+		v1 = vld1q_lane_s16(&filter.table[14][bytes[14]], v1, 6);
+		v1 = vld1q_lane_s16(&filter.table[15][bytes[15]], v1, 7);
+		v0 = vaddq_s16(v0, v1);
+	}
+	int16x4_t sum = vadd_s16(vget_low_s16(v0), vget_high_s16(v0));
+	sum = vpadd_s16(sum, sum);
+	sum = vpadd_s16(sum, sum);
+	return vget_lane_s16(sum, 0);
+}
+
+static void run_filters_neon(const lt_filter_t* const* filters, const lt_status_t* status, unsigned int channels, int16_t* predict) {
+	for (auto ChNr = 0u; ChNr < channels; ChNr++) {
+		predict[ChNr] = run_filter_neon(*filters[ChNr], status[ChNr]);
+	}
+}
+
+#endif
+
+filter_kernel_t::run_filters_t filter_kernel_t::get_run_filters(unsigned int channels, unsigned int tables) {
+	static const run_filters_t run_filters_fn = []() -> run_filters_t {
+#if defined(DST_X86)
+		if (cpu_has_avx512bw()) {
+			return run_filters_avx512bw;
+		}
+		if (cpu_has_avx2()) {
+			return run_filters_avx2;
+		}
+#elif defined(DST_NEON)
+		return run_filters_neon;
+#endif
+		return run_filters;
+	}();
+	return (channels < SIMD_MIN_CHANNELS || tables < SIMD_MIN_TABLES) ? run_filters : run_filters_fn;
+}
+
+}
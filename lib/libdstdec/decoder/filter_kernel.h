@@ -0,0 +1,81 @@
+/*
+* Direct Stream Transfer (DST) codec
+* ISO/IEC 14496-3 Part 3 Subpart 10: Technical description of lossless coding of oversampled audio
+*/
+
+#ifndef FILTER_KERNEL_H
+#define FILTER_KERNEL_H
+
+#include <stdint.h>
+
+namespace dst
+{
+
+/*
+* Prediction filter of one filter set in two layouts: 16 tables of 256 entries, one table per 8 taps,
+* and the taps themselves with their sum, zero past the prediction order.
+* Both are aligned blocks, a gather at the last table entry reads into coef.
+* Tables past the prediction order are all zero, only the first tables, rounded up to 32 taps, are used.
+*/
+struct alignas(64) lt_filter_t {
+	int16_t table[16][256];
+	int16_t coef[128];
+	int16_t coef_sum;
+	int16_t tables;
+};
+
+/*
+* Last 128 bits of one channel, word[0] holds the newest bit in its LSB.
+* Byte TableNr of the status is the table index for the taps TableNr * 8 .. TableNr * 8 + 7.
+*/
+struct alignas(16) lt_status_t {
+	uint64_t word[2];
+	const uint8_t* bytes() const {
+		return reinterpret_cast<const uint8_t*>(word);
+	}
+	void push(unsigned int bit) {
+		word[1] = (word[1] << 1) | (word[0] >> 63);
+		word[0] = (word[0] << 1) | bit;
+	}
+};
+
+/*
+* Predictions of all channels for one bit: the sum of the 16 table entries selected by the status bytes of
+* each channel, truncated to 16 bits as the prediction is. The channels of a bit do not depend on each other,
+* so their kernels overlap.
+* get_run_filters() picks the kernel for the running CPU: with AVX-512BW the status bits mask the taps
+* directly (the prediction is twice the sum of the taps with a 1 bit minus the sum of all taps), with AVX2
+* the table entries are gathered, on NEON they are loaded lane by lane, otherwise the scalar loop is used.
+* Only the low 16 bits of every sum are used, so the kernels add with wrap around and without sign extension.
+* Tables past the prediction order are skipped by every kernel, so the work per bit follows the prediction order.
+* With few channels the decoder soon waits for every prediction, and short filters need few lookups: below
+* SIMD_MIN_CHANNELS or SIMD_MIN_TABLES tables in the longest filter of the frame the scalar loop is as fast
+* or faster.
+*/
+class filter_kernel_t {
+public:
+	using run_filters_t = void(*)(const lt_filter_t* const* filters, const lt_status_t* status, unsigned int channels, int16_t* predict);
+	static constexpr unsigned int SIMD_MIN_CHANNELS = 5;
+	static constexpr unsigned int SIMD_MIN_TABLES = 12;
+	static run_filters_t get_run_filters(unsigned int channels, unsigned int tables);
+	static void run_filters(const lt_filter_t* const* filters, const lt_status_t* status, unsigned int channels, int16_t* predict) {
+		for (auto ChNr = 0u; ChNr < channels; ChNr++) {
+			predict[ChNr] = run_filter(*filters[ChNr], status[ChNr]);
+		}
+	}
+	static int16_t run_filter(const lt_filter_t& filter, const lt_status_t& status) {
+		auto bytes = status.bytes();
+		int Predict = 0;
+		for (auto TableNr = 0; TableNr < filter.tables; TableNr += 4) {
+			Predict += filter.table[TableNr + 0][bytes[TableNr + 0]];
+			Predict += filter.table[TableNr + 1][bytes[TableNr + 1]];
+			Predict += filter.table[TableNr + 2][bytes[TableNr + 2]];
+			Predict += filter.table[TableNr + 3][bytes[TableNr + 3]];
+		}
+		return (int16_t)Predict;
+	}
+};
+
+}
+
+#endif
@@ -31,16 +31,11 @@ public:
 	int rice_decode(unsigned int m) {
 		int LSBs;
 		int Nr;
-		int RLBit;
 		int RunLength;
 		int Sign;
 
 		// Retrieve run length code
-		RunLength = 0;
-		do {
-			RLBit = get_bit(); // Read RL_Bit (Table 10.13)
-			RunLength += (1 - RLBit);
-		} while (!RLBit);
+		RunLength = (int)get_unary(); // Read RL_Bits (Table 10.13)
 		// Retrieve least significant bits
 		LSBs = (int)get_uint(m); // Read LSBs (Table 10.13)
 		Nr = (RunLength << m) + LSBs;
@@ -56,9 +51,7 @@ public:
 
 	// Read DSD data section from DST input stream (Table 10.4)
 	void read_dsd_data(uint8_t* dsd_frame) {
-		for (auto i = 0u; i < MaxFrameLen * NrOfChannels; i++) {
-			dsd_frame[i] = (uint8_t)get_uint(8);
-		}
+		get_bytes(dsd_frame, MaxFrameLen * NrOfChannels);
 	}
 
 	// Read segmentation for Filters and Ptables (Table 10.5)
@@ -396,17 +389,10 @@ public:
 	// - all bits of the arithmetic code
 	void read_arithmetic_coded_data(uint8_t* AData) {
 		auto ADataLen = CalcNrOfBits - get_offset();
-		for (auto j = 0u; j < (ADataLen >> 3); j++) {
-			AData[j] = (uint8_t)get_uint(8); // Read A_Data (Table 10.12)
-		}
-		uint8_t Val = 0;
-		for (auto j = ADataLen & ~7; j < ADataLen; j++) {
-			uint8_t v = get_bit(); // Read A_Data (Table 10.12)
-			Val |= (uint8_t)(v << (7 - (j & 7)));
-			if (j == ADataLen - 1) {
-				AData[j >> 3] = Val;
-				Val = 0;
-			}
+		get_bytes(AData, ADataLen >> 3); // Read A_Data (Table 10.12)
+		auto ADataTail = ADataLen & 7;
+		if (ADataTail) {
+			AData[ADataLen >> 3] = (uint8_t)(get_uint(ADataTail) << (8 - ADataTail)); // Read A_Data (Table 10.12)
 		}
 	}
 
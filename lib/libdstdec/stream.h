@@ -7,6 +7,7 @@
 #define STREAM_H
 
 #include <stdint.h>
+#include <string.h>
 #include <algorithm>
 #include "common.h"
 #include "consts.h"
@@ -16,37 +17,42 @@ using std::min;
 namespace dst
 {
 
+// Bits are read through a 64-bit cache, MSB first. The end of the buffer is only checked when the cache is refilled.
 class stream_t {
 	const uint8_t* m_data;
 	unsigned int   m_size;
-	unsigned int   m_offset;
+	unsigned int   m_next;       // next byte to be loaded into the cache
+	uint64_t       m_cache;      // bits from the read position on, MSB first
+	unsigned int   m_cache_bits; // number of valid bits in the cache
 public:
 	stream_t() {
 		m_data = nullptr;
 		m_size = 0;
-		m_offset = 0;
+		m_next = 0;
+		m_cache = 0;
+		m_cache_bits = 0;
 	}
 
 	void set_data(const uint8_t* data, size_t size) {
 		m_data = data;
 		m_size = size;
-		m_offset = 0;
+		m_next = 0;
+		m_cache = 0;
+		m_cache_bits = 0;
 	}
 
 	unsigned int get_offset() {
-		return m_offset;
+		return 8 * m_next - m_cache_bits;
 	}
 
 	bool get_bit() {
-		if (m_offset + 1 > 8 * m_size) {
-			kodiLog(ADDON_LOG_ERROR, "read after end of stream");
+		if (m_cache_bits < 1 && !refill(1)) {
 			return false;
 		}
-		uint32_t value = m_data[m_offset / 8];
-		value >>= 7 - m_offset % 8;
-		value &= 1;
-		m_offset++;
-		return (bool)value;
+		auto value = (bool)(m_cache >> 63);
+		m_cache <<= 1;
+		m_cache_bits--;
+		return value;
 	}
 
 	int get_sint(unsigned int length) {
@@ -58,20 +64,90 @@ public:
 	}
 
 	uint32_t get_uint(unsigned int length) {
-		if (m_offset + length > 8 * m_size) {
-			kodiLog(ADDON_LOG_ERROR, "read after end of stream");
+		if (m_cache_bits < length && !refill(length)) {
 			return 0;
 		}
-		uint32_t value = 0;
-		for (auto i = 0u; i < (m_offset % 8 + length + 7) / 8; i++) {
-			value = (value << 8) | m_data[m_offset / 8 + i];
-		}
-		value >>= 7 - (m_offset + length - 1) % 8;
-		value &= (1 << length) - 1;
-		m_offset += length;
+		// Split shift, so that a zero length reads nothing
+		auto value = (uint32_t)((m_cache >> 1) >> (63 - length));
+		m_cache <<= length;
+		m_cache_bits -= length;
 		return value;
 	}
 
+	// Count the 0 bits in front of the next 1 bit, both are consumed
+	unsigned int get_unary() {
+		unsigned int zeros = 0;
+		for (;;) {
+			if (m_cache_bits < 1 && !refill(1)) {
+				return zeros;
+			}
+			auto bits = m_cache & (~(uint64_t)0 << (64 - m_cache_bits));
+			if (bits) {
+				auto length = count_leading_zeros(bits);
+				m_cache = (m_cache << length) << 1;
+				m_cache_bits -= length + 1;
+				return zeros + length;
+			}
+			zeros += m_cache_bits;
+			m_cache = 0;
+			m_cache_bits = 0;
+		}
+	}
+
+	void get_bytes(uint8_t* data, unsigned int count) {
+		if (get_offset() % 8 != 0) {
+			for (auto i = 0u; i < count; i++) {
+				data[i] = (uint8_t)get_uint(8);
+			}
+			return;
+		}
+		// Byte aligned: the cached bytes go first, the rest is copied from the buffer
+		while (count > 0 && m_cache_bits >= 8) {
+			*data++ = (uint8_t)(m_cache >> 56);
+			m_cache <<= 8;
+			m_cache_bits -= 8;
+			count--;
+		}
+		if (count > 0) {
+			auto bytes = min(count, m_size - m_next);
+			if (bytes > 0) {
+				memcpy(data, m_data + m_next, bytes);
+				m_next += bytes;
+			}
+			m_cache = 0;
+			if (bytes < count) {
+				kodiLog(ADDON_LOG_ERROR, "read after end of stream");
+				memset(data + bytes, 0, count - bytes);
+			}
+		}
+	}
+
+private:
+	bool refill(unsigned int length) {
+		if (m_next + 8 <= m_size) {
+			// Whole bytes are put below the valid bits. The bits of the last partial byte are loaded
+			// again by the next refill, both loads hold the same stream bits.
+			uint64_t word = 0;
+			for (auto i = 0; i < 8; i++) {
+				word = (word << 8) | m_data[m_next + i];
+			}
+			m_cache |= word >> m_cache_bits;
+			auto bytes = (63 - m_cache_bits) / 8;
+			m_next += bytes;
+			m_cache_bits += 8 * bytes;
+			return true;
+		}
+		while (m_cache_bits <= 56 && m_next < m_size) {
+			m_cache |= (uint64_t)m_data[m_next++] << (56 - m_cache_bits);
+			m_cache_bits += 8;
+		}
+		if (m_cache_bits < length) {
+			kodiLog(ADDON_LOG_ERROR, "read after end of stream");
+			return false;
+		}
+		return true;
+	}
+
 };
 
 }
@@ -9,12 +9,97 @@
 
 #include "Settings.h"
 
+#include <cmath>
+#include <iterator>
+#include <kodi/AudioEngine.h>
 #include <kodi/tools/StringUtils.h>
+#include <map>
+#include <mutex>
 #include <regex>
+#include <sstream>
+#include <type_traits>
 
 namespace
 {
 
+struct ConverterTier
+{
+  conv_type_e type;
+  conv_precision_e precision;
+};
+
+// Converters tried by the automatic mode, from the highest quality down to the cheapest
+constexpr ConverterTier AUTO_TIERS[] = {
+    {conv_type_e::MULTISTAGE, conv_precision_e::FP64},
+    {conv_type_e::MULTISTAGE, conv_precision_e::FP32},
+    {conv_type_e::DIRECT, conv_precision_e::FP64},
+    {conv_type_e::DIRECT, conv_precision_e::FP32},
+    {conv_type_e::DIRECT, conv_precision_e::INT32},
+};
+
+// Tier the automatic mode last settled on per DSD rate and channel count, so the next stream
+// of the same kind starts with the converter that kept up
+std::mutex g_autoTierMutex;
+std::map<std::pair<int, int>, int> g_autoTiers;
+
+int getAutoTier(int dsdSamplerate, int channels)
+{
+  std::lock_guard<std::mutex> lock(g_autoTierMutex);
+  auto it = g_autoTiers.find({dsdSamplerate, channels});
+  return it != g_autoTiers.end() ? it->second : 0;
+}
+
+void setAutoTier(int dsdSamplerate, int channels, int tier)
+{
+  std::lock_guard<std::mutex> lock(g_autoTierMutex);
+  g_autoTiers[{dsdSamplerate, channels}] = tier;
+}
+
+// Fades linearly from the samples in from to the samples in to, both interleaved
+template<typename T>
+void crossfade(T* to, const T* from, int samples, int channels)
+{
+  for (int sample = 0; sample < samples; sample++)
+  {
+    double weight = (sample + 0.5) / samples;
+    for (int ch = 0; ch < channels; ch++)
+    {
+      double value = from[ch] + weight * (static_cast<double>(to[ch]) - from[ch]);
+      if constexpr (std::is_floating_point_v<T>)
+        to[ch] = static_cast<T>(value);
+      else
+        to[ch] = static_cast<T>(std::lround(value));
+    }
+    to += channels;
+    from += channels;
+  }
+}
+
+// Sink formats that keep the 24 bits of a DoP sample unchanged
+bool isDoPSinkFormat(AudioEngineDataFormat format)
+{
+  switch (format)
+  {
+    case AUDIOENGINE_FMT_S32BE:
+    case AUDIOENGINE_FMT_S32LE:
+    case AUDIOENGINE_FMT_S32NE:
+    case AUDIOENGINE_FMT_S24BE4:
+    case AUDIOENGINE_FMT_S24LE4:
+    case AUDIOENGINE_FMT_S24NE4:
+    case AUDIOENGINE_FMT_S24NE4MSB:
+    case AUDIOENGINE_FMT_S24BE3:
+    case AUDIOENGINE_FMT_S24LE3:
+    case AUDIOENGINE_FMT_S24NE3:
+    case AUDIOENGINE_FMT_S32NEP:
+    case AUDIOENGINE_FMT_S24NE4P:
+    case AUDIOENGINE_FMT_S24NE4MSBP:
+    case AUDIOENGINE_FMT_S24NE3P:
+      return true;
+    default:
+      return false;
+  }
+}
+
 std::string getFileExt(const std::string& s)
 {
   size_t i = s.rfind('.', s.length());
@@ -98,45 +183,38 @@ bool CSACDAudioDecoder::Init(const std::string& filename,
     m_pcmMinSamplerate *= 2;
   }
 
-  m_pcmOutSamplerate = std::max(m_pcmMinSamplerate, m_setting_outSamplerate);
+  m_dopOutput = CSACDSettings::GetInstance().GetDoPOutput();
+  m_dopActive = false;
+  m_dopCheckFrames = 0;
+  if (m_dopOutput)
+  {
+    // DoP carries 16 DSD bits of a channel in every 24 bit PCM sample, until the sink is known
+    // to run at that rate the same stream is filled with converted PCM
+    m_pcmOutSamplerate = m_dsdSamplerate / 16;
+    m_pcmOutFormat = pcm_format_e::S24;
+    kodi::Log(ADDON_LOG_INFO,
+              "DoP output needs a bit-perfect path to a DoP DAC: the output device at %d Hz "
+              "without resampling, volume at 100%%, no ReplayGain or other audio processing",
+              m_pcmOutSamplerate);
+  }
+  else
+  {
+    m_pcmOutSamplerate = std::max(m_pcmMinSamplerate, m_setting_outSamplerate);
+    m_pcmOutFormat = CSACDSettings::GetInstance().GetOutputFormat();
+  }
   m_pcmOutMaxSamples = m_pcmOutSamplerate / m_framerate;
-  m_pcmBuffer.resize(m_pcmOutChannels * m_pcmOutMaxSamples);
+  m_pcmBuffer.resize(m_pcmOutChannels * m_pcmOutMaxSamples *
+                     DSDPCMConverterEngine::get_output_bytes(m_pcmOutFormat));
   memset(m_sacdBitrate, 0, sizeof(m_sacdBitrate));
   m_sacdBitrateIdx = 0;
   m_sacdBitrateSum = 0;
 
-  double* fir_data = nullptr;
-  int fir_size = 0;
-  if (CSACDSettings::GetInstance().GetConverterType() == conv_type_e::USER)
-  {
-    std::string path = CSACDSettings::GetInstance().GetConverterFirFile();
-    if (!path.empty() && LoadFir(kodi::addon::GetAddonPath(path)))
-    {
-      fir_data = m_firData.data();
-      fir_size = m_firData.size();
-    }
-  }
-
-  m_dsdPCMDecoder = std::make_unique<DSDPCMConverterEngine>();
-  m_dsdPCMDecoder->set_gain(m_setting_dBVolumeAdjust);
-  int rv =
-      m_dsdPCMDecoder->init(m_pcmOutChannels, m_framerate, m_dsdSamplerate, m_pcmOutSamplerate,
-                            CSACDSettings::GetInstance().GetConverterType(),
-                            CSACDSettings::GetInstance().GetConverterFp64(), fir_data, fir_size);
-  if (rv < 0)
-  {
-    if (rv == -2)
-    {
-      kodi::Log(ADDON_LOG_ERROR, "No installed FIR, continue with the default", "DSD2PCM");
-    }
-    int rv = m_dsdPCMDecoder->init(m_pcmOutChannels, m_framerate, m_dsdSamplerate,
-                                   m_pcmOutSamplerate, conv_type_e::DIRECT,
-                                   CSACDSettings::GetInstance().GetConverterFp64(), nullptr, 0);
-    if (rv < 0)
-    {
-      return false;
-    }
-  }
+  m_autoTier = getAutoTier(m_dsdSamplerate, m_pcmOutChannels);
+  m_autoHoldFrames = AUTO_TIER_HOLD_FRAMES;
+  m_autoSteppedUp = false;
+  m_dsdPCMFadeOut.reset();
+  if (!InitConverter())
+    return false;
 
   m_readFrame = true;
 
@@ -145,10 +223,27 @@ bool CSACDAudioDecoder::Init(const std::string& filename,
    */
   channels = m_pcmOutChannels;
   samplerate = m_pcmOutSamplerate;
-  bitspersample = pcmOutBitsPerSample;
+  switch (m_pcmOutFormat)
+  {
+    case pcm_format_e::S32:
+      bitspersample = 32;
+      format = AUDIOENGINE_FMT_S32NE;
+      break;
+    case pcm_format_e::S24:
+      bitspersample = 24;
+      format = AUDIOENGINE_FMT_S24NE4;
+      break;
+    case pcm_format_e::S16:
+      bitspersample = 16;
+      format = AUDIOENGINE_FMT_S16NE;
+      break;
+    default:
+      bitspersample = 32;
+      format = AUDIOENGINE_FMT_FLOAT;
+      break;
+  }
   bitrate = (int64_t)(m_dsdSamplerate * m_pcmOutChannels) + 500;
   totaltime = sacd_reader->get_duration(subSong) * 1000;
-  format = AUDIOENGINE_FMT_FLOAT;
   channellist = m_pcmOutChannelMap;
 
   return true;
@@ -162,13 +257,13 @@ int CSACDAudioDecoder::ReadPCM(uint8_t* buffer, size_t size, size_t& actualsize)
    */
   if (m_bytesLeft > 0)
   {
-    float* currentPtr = m_bytesLeftNextPtr;
+    uint8_t* currentPtr = m_bytesLeftNextPtr;
 
     actualsize = m_bytesLeft;
     if (actualsize > size)
     {
       m_bytesLeft = actualsize - size;
-      m_bytesLeftNextPtr = currentPtr + size / sizeof(float);
+      m_bytesLeftNextPtr = currentPtr + size;
       actualsize = size;
     }
     else
@@ -241,17 +336,34 @@ int CSACDAudioDecoder::ReadPCM(uint8_t* buffer, size_t size, size_t& actualsize)
    */
   if (dsd_size)
   {
-    auto pcm_out_samples =
-        m_dsdPCMDecoder->convert(dsd_data, dsd_size, m_pcmBuffer.data()) / m_pcmOutChannels;
-    AdjustLFE(m_pcmBuffer.data(), pcm_out_samples, m_pcmOutChannels, m_pcmOutChannelMap);
+    int pcm_out_samples;
+    if (m_dopOutput && !m_dopActive)
+    {
+      CheckDoPSink();
+    }
+    if (m_dopActive)
+    {
+      pcm_out_samples = PackDoP(dsd_data, dsd_size);
+    }
+    else
+    {
+      pcm_out_samples =
+          m_dsdPCMDecoder->convert(dsd_data, dsd_size, m_pcmBuffer.data()) / m_pcmOutChannels;
+      if (m_dsdPCMFadeOut)
+      {
+        FadeOutConverter(dsd_data, dsd_size, pcm_out_samples);
+      }
+      CheckConverterLoad(dsd_data, dsd_size);
+    }
 
-    float* currentPtr = m_pcmBuffer.data();
+    uint8_t* currentPtr = m_pcmBuffer.data();
 
-    actualsize = pcm_out_samples * m_pcmOutChannels * sizeof(float);
+    actualsize = pcm_out_samples * m_pcmOutChannels *
+                 DSDPCMConverterEngine::get_output_bytes(m_pcmOutFormat);
     if (actualsize > size)
     {
       m_bytesLeft = actualsize - size;
-      m_bytesLeftNextPtr = currentPtr + size / sizeof(float);
+      m_bytesLeftNextPtr = currentPtr + size;
       actualsize = size;
     }
 
@@ -381,9 +493,196 @@ int CSACDAudioDecoder::TrackCount(const std::string& filename)
   return GetSubsongCount(CSACDSettings::GetInstance().GetAreaAllowFallback());
 }
 
-void CSACDAudioDecoder::AdjustLFE(float* pcm_data,
-                                  size_t pcm_samples,
-                                  unsigned channels,
+bool CSACDAudioDecoder::InitConverter()
+{
+  conv_type_e conv_type = CSACDSettings::GetInstance().GetConverterType();
+  conv_precision_e conv_precision = CSACDSettings::GetInstance().GetConverterPrecision();
+  if (CSACDSettings::GetInstance().GetConverterAuto())
+  {
+    conv_type = AUTO_TIERS[m_autoTier].type;
+    conv_precision = AUTO_TIERS[m_autoTier].precision;
+  }
+
+  const double* fir_data = nullptr;
+  int fir_size = 0;
+  if (conv_type == conv_type_e::USER)
+  {
+    std::string path = CSACDSettings::GetInstance().GetConverterFirFile();
+    if (!path.empty() && LoadFir(kodi::addon::GetAddonPath(path)))
+    {
+      fir_data = m_firCache.is_loaded() ? m_firCache.get_coefs() : m_firData.data();
+      fir_size = m_firCache.is_loaded() ? m_firCache.get_length() : m_firData.size();
+    }
+  }
+
+  m_dsdPCMDecoder = std::make_unique<DSDPCMConverterEngine>();
+  m_dsdPCMDecoder->set_gain(m_setting_dBVolumeAdjust);
+  m_dsdPCMDecoder->set_frame_parallel(CSACDSettings::GetInstance().GetConverterFrameParallel());
+  m_dsdPCMDecoder->set_channel_group(CSACDSettings::GetInstance().GetConverterChannelGroup());
+  m_dsdPCMDecoder->set_filter_phase(CSACDSettings::GetInstance().GetConverterMinimumPhase()
+                                       ? filter_phase_e::MINIMUM
+                                       : filter_phase_e::LINEAR);
+  m_dsdPCMDecoder->set_output_format(m_pcmOutFormat,
+                                     CSACDSettings::GetInstance().GetOutputDither());
+  AdjustLFE(m_pcmOutChannels, m_pcmOutChannelMap);
+  int rv = m_dsdPCMDecoder->init(m_pcmOutChannels, m_framerate, m_dsdSamplerate,
+                                 m_pcmOutSamplerate, conv_type, conv_precision, fir_data, fir_size);
+  if (rv < 0)
+  {
+    if (rv == -2)
+    {
+      kodi::Log(ADDON_LOG_ERROR, "No installed FIR, continue with the default", "DSD2PCM");
+    }
+    int rv = m_dsdPCMDecoder->init(m_pcmOutChannels, m_framerate, m_dsdSamplerate,
+                                   m_pcmOutSamplerate, conv_type_e::DIRECT, conv_precision,
+                                   nullptr, 0);
+    if (rv < 0)
+    {
+      return false;
+    }
+  }
+  else if (fir_size > 0 && !m_firCache.is_loaded())
+  {
+    SaveFirCache();
+  }
+
+  return true;
+}
+
+void CSACDAudioDecoder::CheckConverterLoad(uint8_t* dsd_data, size_t dsd_size)
+{
+  // Every converter is timed over its first frames. The tier steps down while conversion takes
+  // more than AUTO_TIER_MAX_LOAD of the frame period and tries the better tier once it has run
+  // well below that for the hold time, which doubles each time a better tier does not hold.
+  // No switch is made while the fade of the last one is pending, every switch has to fade.
+  if (!CSACDSettings::GetInstance().GetConverterAuto() || m_dsdPCMFadeOut ||
+      m_dsdPCMDecoder->get_load_frames() < AUTO_TIER_FRAMES)
+    return;
+
+  int frames = m_dsdPCMDecoder->get_load_frames();
+  float load = m_dsdPCMDecoder->get_load();
+  int tier = m_autoTier;
+  if (load > AUTO_TIER_MAX_LOAD && tier + 1 < static_cast<int>(std::size(AUTO_TIERS)))
+  {
+    if (m_autoSteppedUp)
+      m_autoHoldFrames = std::min(2 * m_autoHoldFrames, 16 * AUTO_TIER_HOLD_FRAMES);
+    tier++;
+  }
+  else if (load < AUTO_TIER_UP_LOAD && tier > 0 && frames >= m_autoHoldFrames)
+  {
+    tier--;
+  }
+  else
+  {
+    if (frames >= m_autoHoldFrames)
+      m_autoSteppedUp = false;
+    return;
+  }
+
+  kodi::Log(ADDON_LOG_INFO, "DSD2PCM conversion takes %.0f%% of real time, using a %s converter",
+            load * 100.0f, tier > m_autoTier ? "cheaper" : "better");
+
+  // The current converter stays for one more frame to fade out of, the new one goes on from
+  // the history of this frame. The preroll alone is not enough: the converters differ in delay,
+  // so without the fade the switch leaves a larger step than a cold start would. ReadPCM()
+  // converts the next frame with both and FadeOutConverter() crossfades it, nothing else may
+  // convert in between.
+  int lastTier = m_autoTier;
+  m_autoTier = tier;
+  m_dsdPCMFadeOut = std::move(m_dsdPCMDecoder);
+  if (!InitConverter())
+  {
+    kodi::Log(ADDON_LOG_ERROR, "Failed to initialize the %s converter",
+              tier > lastTier ? "cheaper" : "better");
+    m_autoTier = lastTier;
+    m_dsdPCMDecoder = std::move(m_dsdPCMFadeOut);
+    return;
+  }
+  m_dsdPCMDecoder->preroll(dsd_data, static_cast<int>(dsd_size));
+  m_autoSteppedUp = tier < lastTier;
+  setAutoTier(m_dsdSamplerate, m_pcmOutChannels, tier);
+}
+
+void CSACDAudioDecoder::FadeOutConverter(uint8_t* dsd_data, size_t dsd_size, int pcm_samples)
+{
+  // The converters differ in delay by up to a few dozen samples, fading over one frame from the
+  // replaced converter hides the jump
+  m_pcmFadeBuffer.resize(m_pcmBuffer.size());
+  int fade_samples =
+      std::min(pcm_samples, m_dsdPCMFadeOut->convert(dsd_data, dsd_size, m_pcmFadeBuffer.data()) /
+                                m_pcmOutChannels);
+  switch (m_pcmOutFormat)
+  {
+    case pcm_format_e::S32:
+    case pcm_format_e::S24:
+      crossfade(reinterpret_cast<int32_t*>(m_pcmBuffer.data()),
+                reinterpret_cast<const int32_t*>(m_pcmFadeBuffer.data()), fade_samples,
+                m_pcmOutChannels);
+      break;
+    case pcm_format_e::S16:
+      crossfade(reinterpret_cast<int16_t*>(m_pcmBuffer.data()),
+                reinterpret_cast<const int16_t*>(m_pcmFadeBuffer.data()), fade_samples,
+                m_pcmOutChannels);
+      break;
+    default:
+      crossfade(reinterpret_cast<float*>(m_pcmBuffer.data()),
+                reinterpret_cast<const float*>(m_pcmFadeBuffer.data()), fade_samples,
+                m_pcmOutChannels);
+      break;
+  }
+  m_dsdPCMFadeOut.reset();
+}
+
+void CSACDAudioDecoder::CheckDoPSink()
+{
+  // A resampling or float sink turns DoP into full scale noise, so DoP starts only once the sink
+  // runs at the DoP rate with integer samples of at least 24 bits. Kodi opens the sink for the
+  // stream only after Init() returned and the first frames were read, until then the sink format
+  // is unknown or still the one of the previous stream, so it is polled frame by frame.
+  if (m_dopCheckFrames >= DOP_SINK_CHECK_FRAMES)
+    return;
+
+  m_dopCheckFrames++;
+  kodi::audioengine::AudioEngineFormat sinkFormat;
+  bool sinkKnown = kodi::audioengine::GetCurrentSinkFormat(sinkFormat);
+  if (sinkKnown && static_cast<int>(sinkFormat.GetSampleRate()) == m_pcmOutSamplerate &&
+      isDoPSinkFormat(sinkFormat.GetDataFormat()))
+  {
+    kodi::Log(ADDON_LOG_INFO, "DoP output active at %d Hz", m_pcmOutSamplerate);
+    m_dopActive = true;
+    m_dopMarker = DOP_MARKER_1;
+    // The converter is not used any more, a tier switch pending at this point has nothing to fade
+    m_dsdPCMFadeOut.reset();
+  }
+  else if (m_dopCheckFrames == DOP_SINK_CHECK_FRAMES)
+  {
+    kodi::Log(ADDON_LOG_WARNING,
+              "DoP output needs the audio sink at %d Hz with 24 bit integer samples, it runs at "
+              "%u Hz, converting to PCM instead",
+              m_pcmOutSamplerate, sinkKnown ? sinkFormat.GetSampleRate() : 0);
+  }
+}
+
+int CSACDAudioDecoder::PackDoP(const uint8_t* dsd_data, size_t dsd_size)
+{
+  // Each DoP sample holds the marker in the top byte followed by two DSD bytes, oldest first
+  int32_t* pcm_data = reinterpret_cast<int32_t*>(m_pcmBuffer.data());
+  int pcm_samples = dsd_size / m_pcmOutChannels / 2;
+  for (int sample = 0; sample < pcm_samples; sample++)
+  {
+    const uint8_t* dsd = dsd_data + sample * 2 * m_pcmOutChannels;
+    for (int ch = 0; ch < m_pcmOutChannels; ch++)
+    {
+      uint32_t dop = (static_cast<uint32_t>(m_dopMarker) << 24) | (dsd[ch] << 16) |
+                     (dsd[m_pcmOutChannels + ch] << 8);
+      pcm_data[sample * m_pcmOutChannels + ch] = static_cast<int32_t>(dop) >> 8;
+    }
+    m_dopMarker = (m_dopMarker == DOP_MARKER_1) ? DOP_MARKER_2 : DOP_MARKER_1;
+  }
+  return pcm_samples;
+}
+
+void CSACDAudioDecoder::AdjustLFE(unsigned channels,
                                   const std::vector<AudioEngineChannel>& channel_config)
 {
   if ((channels >= 4) &&
@@ -391,10 +690,8 @@ void CSACDAudioDecoder::AdjustLFE(float* pcm_data,
                   [](AudioEngineChannel i) { return i == AUDIOENGINE_CH_LFE; }) &&
       (m_setting_lfeAdjustCoef != 1.0f))
   {
-    for (size_t sample = 0; sample < pcm_samples; sample++)
-    {
-      pcm_data[sample * channels + 3] *= m_setting_lfeAdjustCoef;
-    }
+    // Applied by the converter, so integer output formats are scaled before quantization
+    m_dsdPCMDecoder->set_channel_gain(3, m_setting_lfeAdjustCoef);
   }
 }
 
@@ -407,14 +704,31 @@ bool CSACDAudioDecoder::LoadFir(const std::string& path)
   if (!file.OpenFile(path))
     return false;
 
+  std::string text;
+  char buffer[4096];
+  ssize_t bytes;
+  while ((bytes = file.Read(buffer, sizeof(buffer))) > 0)
+    text.append(buffer, bytes);
+
   m_firData.clear();
+  m_firName.clear();
+  m_firCache.free();
+
+  m_firHash = DSDPCMFirCache::get_hash(text.data(), text.size());
+  if (m_firCache.load(GetFirCachePath(), m_firHash,
+                      CSACDSettings::GetInstance().GetConverterPrecision()))
+  {
+    m_firName = m_firCache.get_name();
+    return true;
+  }
 
   bool fir_name_is_read = false;
-  while (1)
+  std::istringstream lines(text);
+  std::string str;
+  while (std::getline(lines, str))
   {
-    std::string str;
-    if (!file.ReadLine(str))
-      break;
+    if (!str.empty() && str.back() == '\r')
+      str.pop_back();
 
     if (!str.empty())
     {
@@ -438,6 +752,25 @@ bool CSACDAudioDecoder::LoadFir(const std::string& path)
   return true;
 }
 
+std::string CSACDAudioDecoder::GetFirCachePath() const
+{
+  return kodi::addon::GetUserPath(FIR_CACHE_DIR) +
+         DSDPCMFirCache::get_file_name(m_firHash,
+                                       CSACDSettings::GetInstance().GetConverterPrecision());
+}
+
+void CSACDAudioDecoder::SaveFirCache()
+{
+  // Done once per FIR file and precision, later starts map the compiled file instead of parsing
+  std::string path = GetFirCachePath();
+  kodi::vfs::CreateDirectory(kodi::addon::GetUserPath(FIR_CACHE_DIR));
+  if (!DSDPCMFirCache::save(path, m_firHash, CSACDSettings::GetInstance().GetConverterPrecision(),
+                            m_firData.data(), m_firData.size(), m_firName))
+  {
+    kodi::Log(ADDON_LOG_DEBUG, "Failed to write compiled FIR cache '%s'", path.c_str());
+  }
+}
+
 std::vector<AudioEngineChannel> CSACDAudioDecoder::GetSACDChannelMapFromLoudspeakerConfig(
     int loudspeaker_config)
 {
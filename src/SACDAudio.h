@@ -9,6 +9,7 @@
 
 #include "../lib/libdsdpcm/DSDPCMConverter.h"
 #include "../lib/libdsdpcm/DSDPCMConverterEngine.h"
+#include "../lib/libdsdpcm/DSDPCMFirCache.h"
 #include "../lib/libdstdec/binding/dst_decoder_mt.h"
 #include "Settings.h"
 #include "sacd/sacd_core.h"
@@ -18,6 +19,18 @@
 constexpr int UPDATE_STATS_MS = 500;
 constexpr int BITRATE_AVGS = 16;
 constexpr float PCM_OVERLOAD_THRESHOLD = 1.0f;
+constexpr uint8_t DOP_MARKER_1 = 0x05;
+constexpr uint8_t DOP_MARKER_2 = 0xFA;
+// Frames (2 seconds) DoP output waits for the audio sink to run at the DoP rate before it keeps converting
+constexpr int DOP_SINK_CHECK_FRAMES = 150;
+constexpr const char* FIR_CACHE_DIR = "fircache/";
+// Automatic converter mode: frames measured after an init, the share of the frame period
+// conversion may take, the share below which the better tier is tried and the frames
+// (10 seconds) a tier runs before that
+constexpr int AUTO_TIER_FRAMES = 8;
+constexpr float AUTO_TIER_MAX_LOAD = 0.5f;
+constexpr float AUTO_TIER_UP_LOAD = 0.2f;
+constexpr int AUTO_TIER_HOLD_FRAMES = 750;
 
 class ATTR_DLL_LOCAL CSACDAudioDecoder : public kodi::addon::CInstanceAudioDecoder,
                                          public sacd_core_t
@@ -46,11 +59,15 @@ private:
   std::vector<AudioEngineChannel> GetSACDChannelMapFromChannels(int channels);
   uint32_t GetSubsongCount(bool forceOtherIfEmpty);
   uint32_t GetSubsong(uint32_t p_index);
-  void AdjustLFE(float* pcm_data,
-                 size_t pcm_samples,
-                 unsigned channels,
-                 const std::vector<AudioEngineChannel>& channel_config);
+  bool InitConverter();
+  void CheckConverterLoad(uint8_t* dsd_data, size_t dsd_size);
+  void FadeOutConverter(uint8_t* dsd_data, size_t dsd_size, int pcm_samples);
+  void CheckDoPSink();
+  int PackDoP(const uint8_t* dsd_data, size_t dsd_size);
+  void AdjustLFE(unsigned channels, const std::vector<AudioEngineChannel>& channel_config);
   bool LoadFir(const std::string& path);
+  std::string GetFirCachePath() const;
+  void SaveFirCache();
   std::string GetTrackName(const std::string& file, int& track);
   bool IsUsableIconFile(const kodi::vfs::CDirEntry& item, std::string& iconUsed);
 
@@ -62,6 +79,10 @@ private:
   // Processing parts
   std::unique_ptr<dst_decoder_t> m_dstDecoder;
   std::unique_ptr<DSDPCMConverterEngine> m_dsdPCMDecoder;
+  std::unique_ptr<DSDPCMConverterEngine> m_dsdPCMFadeOut;
+  int m_autoTier = 0;
+  int m_autoHoldFrames = AUTO_TIER_HOLD_FRAMES;
+  bool m_autoSteppedUp = false;
 
   int m_dsdSamplerate;
   std::vector<uint8_t> m_dsdBuf;
@@ -74,6 +95,8 @@ private:
 
   std::vector<double> m_firData;
   std::string m_firName;
+  uint64_t m_firHash = 0;
+  DSDPCMFirCache m_firCache;
 
   // SACD process
   int64_t m_sacdBitrate[BITRATE_AVGS];
@@ -84,13 +107,18 @@ private:
   int m_pcmOutChannels;
   std::vector<AudioEngineChannel> m_pcmOutChannelMap;
   int m_pcmOutSamplerate;
-  int pcmOutBitsPerSample = 32;
+  pcm_format_e m_pcmOutFormat = pcm_format_e::FLOAT;
+  bool m_dopOutput = false;
+  bool m_dopActive = false;
+  int m_dopCheckFrames = 0;
+  uint8_t m_dopMarker = DOP_MARKER_1;
   int m_pcmOutMaxSamples;
   uint64_t m_pcmOutOffset;
   int m_pcmMinSamplerate;
-  std::vector<float> m_pcmBuffer;
+  std::vector<uint8_t> m_pcmBuffer;
+  std::vector<uint8_t> m_pcmFadeBuffer;
 
   // Data for next call if before was not enough space in buffer.
   size_t m_bytesLeft = 0;
-  float* m_bytesLeftNextPtr = nullptr;
+  uint8_t* m_bytesLeftNextPtr = nullptr;
 };
@@ -16,6 +16,12 @@ bool CSACDSettings::Load()
   m_samplerate = kodi::addon::GetSettingInt("samplerate", 352800);
   m_dsd2pcmMode = kodi::addon::GetSettingInt("dsd2pcm-mode", 0);
   m_dsd2pcmFirFile = kodi::addon::GetSettingString("firconverter", "");
+  m_dsd2pcmFrameParallel = kodi::addon::GetSettingBoolean("dsd2pcm-frame-parallel", false);
+  m_dsd2pcmChannelGroup = kodi::addon::GetSettingBoolean("dsd2pcm-channel-group", false);
+  m_dsd2pcmMinimumPhase = kodi::addon::GetSettingBoolean("dsd2pcm-minimum-phase", false);
+  m_dsd2pcmOutputFormat = kodi::addon::GetSettingInt("dsd2pcm-output-format", 0);
+  m_dsd2pcmOutputDither = kodi::addon::GetSettingBoolean("dsd2pcm-output-dither", true);
+  m_dopOutput = kodi::addon::GetSettingBoolean("dop-output", false);
   m_speakerArea = kodi::addon::GetSettingInt("area", 0);
   m_separateMultichannel = kodi::addon::GetSettingBoolean("separate-multichannel", false);
   m_separateMultichannel = kodi::addon::GetSettingBoolean("area-allow-fallback", true);
@@ -51,6 +57,36 @@ bool CSACDSettings::SetSetting(const std::string& settingName,
     if (settingValue.GetInt() != m_dsd2pcmMode)
       m_dsd2pcmMode = settingValue.GetInt();
   }
+  else if (settingName == "dsd2pcm-frame-parallel")
+  {
+    if (settingValue.GetBoolean() != m_dsd2pcmFrameParallel)
+      m_dsd2pcmFrameParallel = settingValue.GetBoolean();
+  }
+  else if (settingName == "dsd2pcm-channel-group")
+  {
+    if (settingValue.GetBoolean() != m_dsd2pcmChannelGroup)
+      m_dsd2pcmChannelGroup = settingValue.GetBoolean();
+  }
+  else if (settingName == "dsd2pcm-minimum-phase")
+  {
+    if (settingValue.GetBoolean() != m_dsd2pcmMinimumPhase)
+      m_dsd2pcmMinimumPhase = settingValue.GetBoolean();
+  }
+  else if (settingName == "dsd2pcm-output-format")
+  {
+    if (settingValue.GetInt() != m_dsd2pcmOutputFormat)
+      m_dsd2pcmOutputFormat = settingValue.GetInt();
+  }
+  else if (settingName == "dsd2pcm-output-dither")
+  {
+    if (settingValue.GetBoolean() != m_dsd2pcmOutputDither)
+      m_dsd2pcmOutputDither = settingValue.GetBoolean();
+  }
+  else if (settingName == "dop-output")
+  {
+    if (settingValue.GetBoolean() != m_dopOutput)
+      m_dopOutput = settingValue.GetBoolean();
+  }
   else if (settingName == "area")
   {
     if (settingValue.GetInt() != m_speakerArea)
@@ -72,30 +108,56 @@ conv_type_e CSACDSettings::GetConverterType() const
   {
     case 0:
     case 1:
+    case 6:
       conv_type = conv_type_e::MULTISTAGE;
       break;
     case 2:
     case 3:
+    case 7:
       conv_type = conv_type_e::DIRECT;
       break;
     case 4:
     case 5:
+    case 8:
       conv_type = conv_type_e::USER;
       break;
   }
   return conv_type;
 }
 
-bool CSACDSettings::GetConverterFp64() const
+conv_precision_e CSACDSettings::GetConverterPrecision() const
 {
-  auto conv_fp64 = false;
+  auto conv_precision = conv_precision_e::FP32;
   switch (m_dsd2pcmMode)
   {
     case 1:
     case 3:
     case 5:
-      conv_fp64 = true;
+      conv_precision = conv_precision_e::FP64;
+      break;
+    case 6:
+    case 7:
+    case 8:
+      conv_precision = conv_precision_e::INT32;
+      break;
+  }
+  return conv_precision;
+}
+
+pcm_format_e CSACDSettings::GetOutputFormat() const
+{
+  auto pcm_format = pcm_format_e::FLOAT;
+  switch (m_dsd2pcmOutputFormat)
+  {
+    case 1:
+      pcm_format = pcm_format_e::S32;
+      break;
+    case 2:
+      pcm_format = pcm_format_e::S24;
+      break;
+    case 3:
+      pcm_format = pcm_format_e::S16;
       break;
   }
-  return conv_fp64;
+  return pcm_format;
 }
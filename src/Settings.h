@@ -29,7 +29,14 @@ public:
   int GetConverterMode() const { return m_dsd2pcmMode; }
   const std::string& GetConverterFirFile() const { return m_dsd2pcmFirFile; }
   conv_type_e GetConverterType() const;
-  bool GetConverterFp64() const;
+  conv_precision_e GetConverterPrecision() const;
+  bool GetConverterAuto() const { return m_dsd2pcmMode == 9; }
+  bool GetConverterFrameParallel() const { return m_dsd2pcmFrameParallel; }
+  bool GetConverterChannelGroup() const { return m_dsd2pcmChannelGroup; }
+  bool GetConverterMinimumPhase() const { return m_dsd2pcmMinimumPhase; }
+  pcm_format_e GetOutputFormat() const;
+  bool GetOutputDither() const { return m_dsd2pcmOutputDither; }
+  bool GetDoPOutput() const { return m_dopOutput; }
   int GetSpeakerArea() const { return m_speakerArea; }
   bool GetFullPlayback() const { return false; } // unused
   bool GetSeparateMultichannel() const { return m_speakerArea == 0 && m_separateMultichannel; }
@@ -43,6 +50,12 @@ private:
   int m_samplerate = 352800;
   int m_dsd2pcmMode = 0;
   std::string m_dsd2pcmFirFile;
+  bool m_dsd2pcmFrameParallel = false;
+  bool m_dsd2pcmChannelGroup = false;
+  bool m_dsd2pcmMinimumPhase = false;
+  int m_dsd2pcmOutputFormat = 0;
+  bool m_dsd2pcmOutputDither = true;
+  bool m_dopOutput = false;
   int m_speakerArea = 0;
   bool m_separateMultichannel = false;
   bool m_areaAllowFallback = true;